@@ -0,0 +1,293 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Non interactive benchmark: sweeps queue backends, work type (callables or streams), producers,
+// consumers, task cost and production pattern, and prints one CSV line per case (header first)
+// to standard output.
+//
+// Backend 'basic' is the compile-time dispatcher (BasicQueueDispatcher) with a lock-free queue, no timing,
+// a concrete task type and the same pool sizes, as a baseline for the runtime-configured backends.
+//
+// Usage: benchmark [--tasks <per case, 100000>] [--backend <locked|lockfree|workstealing|numa|basic>] [--spin <iterations, 0>]
+
+// C
+#include <libgen.h> // basename
+#include <sys/resource.h>
+
+// Standard
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <limits>
+
+#include <ert/tracing/Logger.hpp>
+
+#include <ert/queuedispatcher/QueueDispatcher.hpp>
+#include <ert/queuedispatcher/BasicQueueDispatcher.hpp>
+
+#define BURST_SIZE 1000 // tasks dispatched back to back in burst pattern
+#define BURST_PAUSE_US 1000 // pause between bursts
+#define QUEUE_CAPACITY 8192 // producers block when reached, so latency measures the queue and not an unbounded backlog
+
+using namespace ert::queuedispatcher;
+using Clock = std::chrono::steady_clock;
+
+const char* progname;
+
+struct Case {
+    std::string backend;
+    std::string work; // callable, stream (or task for basic backend)
+    int producers;
+    int threads;
+    int maxThreads;
+    int costNs; // busy loop per task
+    bool burst;
+};
+
+struct Result {
+    double seconds;
+    unsigned long long p50, p99, p999; // end-to-end latency (dispatch to processing end) in nanoseconds
+    double contextSwitches; // per task (voluntary and involuntary, whole process)
+};
+
+Backend backendType(const std::string &name) {
+    if (name == "lockfree") return Backend::LockFree;
+    if (name == "workstealing") return Backend::WorkStealing;
+    if (name == "numa") return Backend::Numa;
+    return Backend::Locked;
+}
+
+int usage(const std::string &error) {
+    std::cerr << progname << ": " << error << std::endl
+              << "Usage: " << progname << " [--tasks <per case, 100000>] [--backend <locked|lockfree|workstealing|numa|basic>] [--spin <iterations, 0>]" << std::endl;
+    return 1;
+}
+
+// Decimal number (whole argument, no sign):
+bool parseNumber(const char *arg, unsigned long &value) {
+    if (!isdigit((unsigned char)arg[0])) return false;
+    char *end;
+    errno = 0;
+    value = std::strtoul(arg, &end, 10);
+    return *end == '\0' && errno == 0;
+}
+
+long contextSwitches() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+void spin(int ns) {
+    if (ns <= 0) return;
+    auto until = Clock::now() + std::chrono::nanoseconds(ns);
+    while (Clock::now() < until) {;}
+}
+
+// Stream work (allocated per task, as streams are usually dispatched):
+class BenchmarkStream : public StreamIf {
+public:
+    BenchmarkStream(std::atomic<size_t> *done, unsigned long long *latency, Clock::time_point dispatched, int cost) :
+        done_(done), latency_(latency), dispatched_(dispatched), cost_(cost) {}
+
+    void process(bool busyConsumers, int queueSize) override {
+        spin(cost_);
+        *latency_ = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - dispatched_).count();
+        done_->fetch_add(1, std::memory_order_release);
+    }
+
+private:
+    std::atomic<size_t> *done_;
+    unsigned long long *latency_;
+    Clock::time_point dispatched_;
+    int cost_;
+};
+
+// Task of the compile-time dispatcher (no type erasure):
+struct BasicTask {
+    std::atomic<size_t> *done = nullptr;
+    unsigned long long *latency = nullptr;
+    Clock::time_point dispatched;
+    int cost = 0;
+
+    void operator()() {
+        spin(cost);
+        *latency = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - dispatched).count();
+        done->fetch_add(1, std::memory_order_release);
+    }
+};
+
+using BasicDispatcher = BasicQueueDispatcher<BasicTask, LockFreeQueue, BlockingWait, NoTiming, ElasticPool>;
+
+Result run(const Case &c, size_t tasks, unsigned spinIterations) {
+    std::vector<unsigned long long> latencies(tasks);
+    std::atomic<size_t> done{0};
+    size_t perProducer = tasks / c.producers;
+    tasks = perProducer * c.producers;
+
+    std::unique_ptr<QueueDispatcher> queue;
+    std::unique_ptr<BasicDispatcher> basic;
+    if (c.backend == "basic") {
+        basic.reset(new BasicDispatcher("benchmark", ElasticPool(c.threads, c.maxThreads), QUEUE_CAPACITY));
+    }
+    else {
+        Settings settings;
+        settings.threads = c.threads;
+        settings.maxThreads = c.maxThreads;
+        settings.backend = backendType(c.backend);
+        settings.capacity = QUEUE_CAPACITY;
+        settings.overloadPolicy = OverloadPolicy::Block;
+        settings.spinIterations = spinIterations;
+        queue.reset(new QueueDispatcher("benchmark", settings));
+    }
+
+    long csw = contextSwitches();
+    auto begin = Clock::now();
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < c.producers; p++) {
+        producers.emplace_back([&, p] {
+            unsigned long long *latency = latencies.data() + p * perProducer;
+            for (size_t i = 0; i < perProducer; i++) {
+                if (c.burst && i > 0 && i % BURST_SIZE == 0) std::this_thread::sleep_for(std::chrono::microseconds(BURST_PAUSE_US));
+
+                auto dispatched = Clock::now();
+                if (basic) {
+                    basic->dispatch(BasicTask{&done, latency + i, dispatched, c.costNs});
+                    continue;
+                }
+                if (c.work == "stream") {
+                    queue->dispatch(std::make_shared<BenchmarkStream>(&done, latency + i, dispatched, c.costNs));
+                    continue;
+                }
+                queue->dispatch([&done, latency, i, dispatched, cost = c.costNs] {
+                    spin(cost);
+                    latency[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - dispatched).count();
+                    done.fetch_add(1, std::memory_order_release);
+                });
+            }
+        });
+    }
+    for (auto &producer: producers) producer.join();
+
+    while (done.load(std::memory_order_acquire) < tasks) std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+    Result result;
+    result.seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    result.contextSwitches = double(contextSwitches() - csw) / tasks;
+
+    latencies.resize(tasks);
+    auto percentile = [&latencies](double q) {
+        size_t n = std::min(latencies.size() - 1, size_t(q * latencies.size()));
+        std::nth_element(latencies.begin(), latencies.begin() + n, latencies.end());
+        return latencies[n];
+    };
+    result.p50 = percentile(0.5);
+    result.p99 = percentile(0.99);
+    result.p999 = percentile(0.999);
+
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+
+    progname = basename(argv[0]);
+    ert::tracing::Logger::initialize(progname);
+
+    size_t tasks = 100000;
+    unsigned spinIterations = 0;
+    std::vector<std::string> backends{"locked", "lockfree", "workstealing", "numa", "basic"};
+
+    for (int i = 1; i < argc; i++) {
+        std::string opt = argv[i];
+        if (opt != "--tasks" && opt != "--spin" && opt != "--backend") return usage("unknown option '" + opt + "'");
+        if (i + 1 == argc) return usage("missing value for " + opt);
+        std::string value = argv[++i];
+        unsigned long number = 0;
+
+        if (opt == "--backend") {
+            if (std::find(backends.begin(), backends.end(), value) == backends.end()) return usage("unknown backend '" + value + "'");
+            backends = {value};
+        }
+        else if (!parseNumber(value.c_str(), number)) {
+            return usage("invalid number '" + value + "' for " + opt);
+        }
+        else if (opt == "--tasks") {
+            if (number == 0) return usage("--tasks must be positive");
+            tasks = number;
+        }
+        else {
+            if (number > std::numeric_limits<unsigned>::max()) return usage("--spin out of range");
+            spinIterations = number;
+        }
+    }
+
+    // Consumers: single, fixed pool and elastic pool
+    std::vector<std::pair<int, int>> pools{{1, 1}, {4, 4}, {2, 8}};
+
+    std::cout << "backend,work,producers,threads,max_threads,cost_ns,pattern,tasks,seconds,tasks_per_s,p50_ns,p99_ns,p999_ns,csw_per_task" << std::endl;
+
+    for (auto &backend: backends) {
+        std::vector<std::string> works{"callable", "stream"};
+        if (backend == "basic") works = {"task"};
+
+        for (auto &work: works) {
+            for (int producers: {1, 4}) {
+                for (auto &pool: pools) {
+                    for (int cost: {0, 1000, 5000}) {
+                        for (bool burst: {false, true}) {
+                            Case c{backend, work, producers, pool.first, pool.second, cost, burst};
+                            Result r = run(c, tasks, spinIterations);
+                            size_t total = (tasks / producers) * producers;
+                            std::cout << backend << ',' << work << ',' << producers << ',' << pool.first << ',' << pool.second << ',' << cost << ','
+                                      << (burst ? "burst":"steady") << ',' << total << ',' << r.seconds << ',' << (unsigned long long)(total / r.seconds) << ','
+                                      << r.p50 << ',' << r.p99 << ',' << r.p999 << ',' << r.contextSwitches << std::endl;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
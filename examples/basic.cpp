@@ -0,0 +1,241 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Non interactive example of the policy-based dispatcher (BasicQueueDispatcher.hpp), also run as test:
+// every combination of queue, wait, timing and growth policies is checked for FIFO delivery, capacity,
+// pool growth, processing time reports and destruction. Exit code is the number of failures.
+
+// C
+#include <libgen.h> // basename
+
+// Standard
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include <ert/queuedispatcher/BasicQueueDispatcher.hpp>
+
+#define TASKS 1000
+#define QUEUE_CAPACITY 4 // power of two, so lock-free rings keep it as given
+#define MAX_THREADS 3 // elastic pools start with a single consumer
+
+using namespace ert::queuedispatcher;
+
+const char* progname;
+
+// Waits for a condition up to a second:
+template <typename Condition>
+bool waitFor(Condition condition) {
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > until) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+// Shared by the tasks of a case:
+struct Probe {
+    std::atomic<bool> release{true}; // consumers are held in their task until released
+    std::atomic<int> processed{0};
+    std::atomic<int> lapses{0};
+    std::mutex lock;
+    std::vector<int> order;
+};
+
+struct ProbeTask {
+    Probe *probe = nullptr;
+    int id = 0;
+
+    void operator()() {
+        while (!probe->release) std::this_thread::sleep_for(std::chrono::microseconds(100));
+        {
+            std::lock_guard<std::mutex> guard(probe->lock);
+            probe->order.push_back(id);
+        }
+        probe->processed++;
+    }
+
+    void processLapse(unsigned long long lapse) {
+        probe->lapses++;
+    }
+};
+
+template <template <typename> class Queue, typename Wait, typename Timing, typename Growth>
+int check(const std::string &name, Growth growth) {
+    using Dispatcher = BasicQueueDispatcher<ProbeTask, Queue, Wait, Timing, Growth>;
+    constexpr bool timed = std::is_same<Timing, LapseTiming>::value;
+    int failures = 0;
+
+    // Every task is processed (in order with a single consumer), and only timed with lapse timing:
+    {
+        Probe probe;
+        {
+            Dispatcher queue(name, growth);
+            for (int i = 0; i < TASKS; i++) queue.dispatch(ProbeTask{&probe, i});
+            waitFor([&probe] { return probe.processed == TASKS && (!timed || probe.lapses == TASKS); });
+        }
+
+        bool ordered = true;
+        for (int i = 0; i < int(probe.order.size()); i++) ordered &= (probe.order[i] == i);
+        if (probe.processed != TASKS || probe.lapses != (timed ? TASKS:0) || (growth.maximum() == 1 && !ordered)) {
+            std::cout << name << ": processed " << probe.processed << ", lapses " << probe.lapses << ", ordered " << ordered << std::endl;
+            failures++;
+        }
+    }
+
+    // Bounded queue refuses tasks when full (elastic pool grows meanwhile, as consumers are busy):
+    {
+        Probe probe;
+        probe.release = false;
+        int accepted = 0;
+        bool refused = false;
+        size_t threads = 0;
+        {
+            Dispatcher queue(name, growth, QUEUE_CAPACITY);
+            for (size_t i = 0; i <= QUEUE_CAPACITY + growth.maximum(); i++) {
+                if (!queue.tryDispatch(ProbeTask{&probe, accepted})) {
+                    refused = true;
+                    break;
+                }
+                accepted++;
+
+                // Consumers take tasks while some of them is idle:
+                waitFor([&queue] { return queue.getSize() == 0 || queue.getBusyThreads() == queue.getThreads(); });
+            }
+            threads = queue.getThreads();
+
+            probe.release = true;
+            waitFor([&probe, accepted] { return probe.processed == accepted; });
+        }
+
+        if (!refused || accepted != int(QUEUE_CAPACITY + growth.maximum()) || threads != growth.maximum() || probe.processed != accepted) {
+            std::cout << name << ": refused " << refused << ", accepted " << accepted << ", threads " << threads << ", processed " << probe.processed << std::endl;
+            failures++;
+        }
+    }
+
+    // Destruction completes tasks in hand and discards pending ones:
+    {
+        Probe probe;
+        probe.release = false;
+        std::thread releaser;
+        {
+            Dispatcher queue(name, growth);
+            for (int i = 0; i < TASKS; i++) queue.dispatch(ProbeTask{&probe, i});
+            waitFor([&queue] { return queue.getBusyThreads() == queue.getThreads(); });
+
+            releaser = std::thread([&probe] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                probe.release = true;
+            });
+        }
+        releaser.join();
+
+        if (probe.processed >= TASKS) {
+            std::cout << name << ": pending tasks processed on destruction" << std::endl;
+            failures++;
+        }
+    }
+
+    std::cout << name << ": " << (failures ? "failed":"ok") << std::endl;
+    return failures;
+}
+
+template <template <typename> class Queue, typename Wait, typename Timing>
+int checkGrowth(const std::string &name) {
+    return check<Queue, Wait, Timing>(name + "/fixed", FixedPool(1)) + check<Queue, Wait, Timing>(name + "/elastic", ElasticPool(1, MAX_THREADS));
+}
+
+template <template <typename> class Queue, typename Wait>
+int checkTiming(const std::string &name) {
+    return checkGrowth<Queue, Wait, NoTiming>(name + "/notiming") + checkGrowth<Queue, Wait, LapseTiming>(name + "/lapsetiming");
+}
+
+template <template <typename> class Queue>
+int checkWait(const std::string &name) {
+    return checkTiming<Queue, BlockingWait>(name + "/blocking") + checkTiming<Queue, SpinWait<1000>>(name + "/spin");
+}
+
+// Streams get the congestion arguments of StreamIf::process() and their processing time:
+class CongestionStream : public StreamIf {
+public:
+    CongestionStream(Probe *probe) : probe_(probe) {}
+
+    void process(bool busyConsumers, int queueSize) override {
+        while (!probe_->release) std::this_thread::sleep_for(std::chrono::microseconds(100));
+        std::lock_guard<std::mutex> guard(probe_->lock);
+        probe_->order.push_back(busyConsumers ? queueSize:-1);
+    }
+
+    void processLapse(unsigned long long lapse) override {
+        probe_->lapses++;
+    }
+
+private:
+    Probe *probe_;
+};
+
+int checkStreams() {
+    Probe probe;
+    probe.release = false;
+    {
+        BasicQueueDispatcher<StreamTask, LockFreeQueue, BlockingWait, LapseTiming, FixedPool> queue("streams", FixedPool(1));
+        for (int i = 0; i < 4; i++) {
+            queue.dispatch(StreamTask{std::make_shared<CongestionStream>(&probe)});
+            if (i == 0) waitFor([&queue] { return queue.getBusyThreads() == 1; });
+        }
+        probe.release = true;
+        waitFor([&probe] { return probe.lapses == 4; });
+    }
+
+    // Single consumer is busy with every stream, and the ones behind the first are left behind the rest:
+    bool ok = (probe.order == std::vector<int>{0, 2, 1, 0} && probe.lapses == 4);
+    std::cout << "streams: " << (ok ? "ok":"failed") << std::endl;
+    return ok ? 0:1;
+}
+
+int main(int argc, char* argv[]) {
+
+    progname = basename(argv[0]);
+
+    int failures = checkWait<LockedQueue>("locked") + checkWait<LockFreeQueue>("lockfree") + checkStreams();
+    return failures;
+}
@@ -0,0 +1,205 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// Non interactive example of C++20 coroutine handlers (Coroutine.hpp), also run as test: handlers
+// hop to consumer threads, await results completed from a service thread, and survive drop-oldest
+// overload and queue destruction (standalone and virtual queues) without leaking their frames. Exit
+// code is the number of failures.
+
+// C
+#include <libgen.h> // basename
+
+// Standard
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <deque>
+
+#include <ert/tracing/Logger.hpp>
+
+#include <ert/queuedispatcher/QueueDispatcher.hpp>
+#include <ert/queuedispatcher/Executor.hpp>
+#include <ert/queuedispatcher/Coroutine.hpp>
+
+#define HANDLERS 1000
+#define QUEUE_CAPACITY 8 // small, so drop-oldest policy evicts pending resumptions
+
+using namespace ert::queuedispatcher;
+
+const char* progname;
+std::atomic<int> frames{0}; // coroutine frames alive
+std::atomic<int> finished{0};
+
+struct Frame {
+    Frame() {
+        frames++;
+    }
+    ~Frame() {
+        frames--;
+    }
+};
+
+// Callback based API completed from its own thread (i.e. an I/O one):
+class Service {
+public:
+    Service() : thread_([this] { run(); }) {}
+
+    ~Service() {
+        quit_ = true;
+        thread_.join();
+    }
+
+    void send(int request, Completion<int> *response) {
+        std::lock_guard<std::mutex> guard(lock_);
+        pending_.emplace_back(request, response);
+    }
+
+private:
+    std::mutex lock_;
+    std::deque<std::pair<int, Completion<int>*>> pending_;
+    std::atomic<bool> quit_{false};
+    std::thread thread_;
+
+    void run() {
+        while (!quit_) {
+            std::pair<int, Completion<int>*> next{0, nullptr};
+            {
+                std::lock_guard<std::mutex> guard(lock_);
+                if (!pending_.empty()) {
+                    next = pending_.front();
+                    pending_.pop_front();
+                }
+            }
+            if (next.second) next.second->complete(next.first * 2);
+            else std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+};
+
+CoTask<int> query(QueueDispatcher &queue, Service &service, int request) {
+    Completion<int> response(queue);
+    service.send(request, &response);
+    co_return co_await response; // resumed on a consumer thread
+}
+
+CoTask<> handle(QueueDispatcher &queue, Service &service, int request, std::atomic<int> &errors) {
+    Frame frame;
+    co_await queue.schedule();
+    int response = co_await query(queue, service, request);
+    if (response != request * 2) errors++;
+    finished++;
+}
+
+CoTask<> hop(QueueDispatcher &queue) {
+    Frame frame;
+    co_await queue.schedule();
+    finished++;
+}
+
+CoTask<> hops(QueueDispatcher &queue) {
+    Frame frame;
+    co_await queue.schedule();
+    co_await queue.schedule();
+    finished++;
+}
+
+int main(int argc, char* argv[]) {
+
+    progname = basename(argv[0]);
+    ert::tracing::Logger::initialize(progname);
+
+    int failures = 0;
+
+    // Handlers under overload: pending resumptions evicted by drop-oldest policy are resumed instead of discarded
+    {
+        Settings settings;
+        settings.threads = 2;
+        settings.capacity = QUEUE_CAPACITY;
+        settings.overloadPolicy = OverloadPolicy::DropOldest;
+        QueueDispatcher queue("coroutines", settings);
+        Service service;
+        std::atomic<int> errors{0};
+
+        // Plain tasks are dispatched meanwhile: their admission evicts the oldest pending tasks
+        for (int i = 0; i < HANDLERS; i++) {
+            spawn(queue, handle(queue, service, i, errors));
+            for (int j = 0; j < QUEUE_CAPACITY; j++) queue.dispatch([] { std::this_thread::sleep_for(std::chrono::microseconds(10)); });
+        }
+
+        auto until = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (finished < HANDLERS && std::chrono::steady_clock::now() < until) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        std::cout << "handlers finished: " << finished << "/" << HANDLERS << ", wrong responses: " << errors << std::endl;
+        if (finished != HANDLERS || errors != 0) failures++;
+    }
+
+    // Queue destruction: pending resumptions are run instead of discarded
+    finished = 0;
+    {
+        QueueDispatcher queue("destroyed", 1);
+        std::atomic<bool> release{false};
+        queue.dispatch([&release] { while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1)); });
+
+        for (int i = 0; i < HANDLERS; i++) spawn(queue, hop(queue));
+        release = true;
+    }
+    std::cout << "handlers finished on destruction: " << finished << "/" << HANDLERS << std::endl;
+    if (finished != HANDLERS) failures++;
+
+    // Virtual queue destruction: resumptions run by the destructor schedule again once the queue left
+    // its executor (whose only thread is kept busy by another queue meanwhile)
+    finished = 0;
+    {
+        auto executor = std::make_shared<Executor>("executor", 1);
+        QueueDispatcher busy("busy", executor);
+        std::atomic<bool> release{false};
+        busy.dispatch([&release] { while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1)); });
+        {
+            QueueDispatcher queue("virtual", executor);
+            for (int i = 0; i < HANDLERS; i++) spawn(queue, hops(queue));
+        }
+        release = true;
+    }
+    std::cout << "handlers finished on virtual queue destruction: " << finished << "/" << HANDLERS << std::endl;
+    if (finished != HANDLERS) failures++;
+
+    std::cout << "coroutine frames alive: " << frames << std::endl;
+    if (frames != 0) failures++;
+
+    return failures;
+}
@@ -0,0 +1,143 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Non interactive example of pooled streams (StreamPool.hpp), also run as test: once the pool and the
+// queue are warmed up, creating, dispatching, processing and releasing streams does no heap allocation
+// (counted on global operator new) on any backend. Exit code is the number of failures.
+
+// C
+#include <libgen.h> // basename
+
+// Standard
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <ert/tracing/Logger.hpp>
+
+#include <ert/queuedispatcher/QueueDispatcher.hpp>
+#include <ert/queuedispatcher/StreamPool.hpp>
+
+#define ROUND_SIZE 512 // streams dispatched per round (all of them fit in the pool)
+#define WARMUP_ROUNDS 20
+
+using namespace ert::queuedispatcher;
+
+const char* progname;
+std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(size ? size:1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+class PooledStream : public StreamIf {
+public:
+    PooledStream(std::atomic<size_t> *done, int request) : done_(done), request_(request) {}
+
+    void process(bool busyConsumers, int queueSize) override {
+        response_ = request_ * 2;
+        done_->fetch_add(1, std::memory_order_release);
+    }
+
+private:
+    std::atomic<size_t> *done_;
+    int request_;
+    int response_ = 0;
+};
+
+const char *backendName(Backend backend) {
+    switch (backend) {
+    case Backend::LockFree: return "lockfree";
+    case Backend::WorkStealing: return "workstealing";
+    default: return "locked";
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    progname = basename(argv[0]);
+    ert::tracing::Logger::initialize(progname);
+
+    int failures = 0;
+
+    for (Backend backend: {Backend::Locked, Backend::LockFree, Backend::WorkStealing}) {
+        Settings settings;
+        settings.threads = 2;
+        settings.backend = backend;
+        QueueDispatcher queue("pooled", settings);
+        StreamPool<PooledStream> pool(ROUND_SIZE * 2);
+        std::atomic<size_t> done{0};
+
+        // Pool gets a block per stream of a round (streams created during a round may reuse the ones
+        // released meanwhile, so rounds alone could leave it with fewer):
+        {
+            std::vector<std::shared_ptr<PooledStream>> streams;
+            for (int i = 0; i < ROUND_SIZE; i++) streams.push_back(pool.make(&done, i));
+        }
+
+        // A round completes when its blocks are back in the pool (released after processing):
+        auto round = [&] {
+            done = 0;
+            for (int i = 0; i < ROUND_SIZE; i++) queue.dispatch(pool.make(&done, i));
+            while (done.load(std::memory_order_acquire) < ROUND_SIZE || pool.getIdle() < ROUND_SIZE) std::this_thread::sleep_for(std::chrono::microseconds(100));
+        };
+
+        for (int i = 0; i < WARMUP_ROUNDS; i++) round();
+
+        size_t before = allocations.load();
+        round();
+        size_t count = allocations.load() - before;
+
+        std::cout << backendName(backend) << " backend: " << count << " heap allocations for " << ROUND_SIZE << " pooled streams" << std::endl;
+        if (count != 0) failures++;
+    }
+
+    return failures;
+}
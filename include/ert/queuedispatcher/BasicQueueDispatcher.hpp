@@ -0,0 +1,470 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ert/queuedispatcher/StreamIf.hpp>
+#include <ert/queuedispatcher/MpmcRing.hpp>
+#include <ert/queuedispatcher/Parking.hpp>
+#include <ert/queuedispatcher/Fifo.hpp>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+namespace detail
+{
+// Tasks reporting their processing time (processLapse(nanoseconds)):
+template <typename Task, typename = void>
+struct HasProcessLapse : std::false_type {};
+
+template <typename Task>
+struct HasProcessLapse<Task, std::void_t<decltype(std::declval<Task&>().processLapse(0ull))>> : std::true_type {};
+}
+
+/**
+ * Queue policy: unbounded (or bounded) FIFO protected by a mutex
+ */
+template <typename Task>
+class LockedQueue
+{
+public:
+    /** @param capacity maximum number of pending tasks (zero: unbounded) */
+    explicit LockedQueue(size_t capacity = 0) : capacity_(capacity) {}
+
+    /** @return false if capacity is reached (task is untouched) */
+    bool tryPush(Task &&task) {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (capacity_ > 0 && fifo_.size() >= capacity_) return false;
+        fifo_.push(std::move(task));
+        size_.store(fifo_.size(), std::memory_order_release);
+        return true;
+    }
+
+    /** @return false if the queue is empty */
+    bool tryPop(Task &task) {
+        if (empty()) return false;
+        std::lock_guard<std::mutex> guard(lock_);
+        if (fifo_.empty()) return false;
+        task = std::move(fifo_.front());
+        fifo_.pop();
+        size_.store(fifo_.size(), std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return size_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+private:
+    std::mutex lock_;
+    Fifo<Task> fifo_;
+    std::atomic<size_t> size_{0};
+    size_t capacity_;
+};
+
+/**
+ * Queue policy: bounded lock-free MPMC ring (see MpmcRing)
+ */
+template <typename Task>
+class LockFreeQueue
+{
+public:
+    /** @param capacity ring capacity, rounded up to power of two (zero: 1024) */
+    explicit LockFreeQueue(size_t capacity = 0) : ring_(capacity ? capacity:1024) {}
+
+    /** @return false if the ring is full (task is untouched) */
+    bool tryPush(Task &&task) {
+        return ring_.tryPush(std::move(task));
+    }
+
+    /** @return false if the ring is empty */
+    bool tryPop(Task &task) {
+        return ring_.tryPop(task);
+    }
+
+    size_t size() const {
+        return ring_.size();
+    }
+
+    bool empty() const {
+        return ring_.empty();
+    }
+
+private:
+    MpmcRing<Task> ring_;
+};
+
+/**
+ * Wait policy: idle consumers park on a condition variable, and producers only
+ * notify when some consumer is parked
+ */
+class BlockingWait
+{
+public:
+    /**
+     * Waits until there is work or the dispatcher stops
+     *
+     * @param ready pending work check
+     *
+     * @return false when stopped
+     */
+    template <typename Ready>
+    bool wait(Ready ready) {
+        // Registered as sleeper before checking pending work (see Sleepers):
+        std::unique_lock<std::mutex> lock(lock_);
+        sleepers_.park();
+        while (!stopped() && !ready()) cv_.wait(lock);
+        sleepers_.unpark();
+        return !stopped();
+    }
+
+    /** Wakes up to count parked consumers */
+    void notify(size_t count = 1) {
+        sleepers_.wake(lock_, cv_, count);
+    }
+
+    /** Stops every consumer */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            quit_.store(true);
+        }
+        cv_.notify_all();
+    }
+
+    bool stopped() const {
+        return quit_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::mutex lock_;
+    std::condition_variable cv_;
+    Sleepers sleepers_;
+    std::atomic<bool> quit_{false};
+};
+
+/**
+ * Wait policy: idle consumers poll for some iterations (pausing the CPU, and yielding
+ * for the second half) before parking (see BlockingWait)
+ */
+template <unsigned Iterations>
+class SpinWait : public BlockingWait
+{
+public:
+    template <typename Ready>
+    bool wait(Ready ready) {
+        if (spinUntil(Iterations, [this, &ready] { return stopped() || ready(); })) return !stopped();
+        return BlockingWait::wait(ready);
+    }
+};
+
+/**
+ * Timing policy: tasks are not timed
+ */
+struct NoTiming {
+    template <typename Task, typename Run>
+    void process(Task &task, Run &&run) {
+        run();
+    }
+};
+
+/**
+ * Timing policy: processing time of every task is reported to the task itself
+ * (processLapse(nanoseconds), when the task type provides it)
+ */
+struct LapseTiming {
+    template <typename Task, typename Run>
+    void process(Task &task, Run &&run) {
+        auto begin = std::chrono::steady_clock::now();
+        run();
+        if constexpr (detail::HasProcessLapse<Task>::value) {
+            task.processLapse(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+        }
+    }
+};
+
+/**
+ * Growth policy: fixed consumers pool
+ */
+struct FixedPool {
+    static constexpr bool Elastic = false;
+
+    /** @param threads number of consumer threads (minimum 1) */
+    explicit FixedPool(size_t threads = 1) : threads_(threads ? threads:1) {}
+
+    size_t initial() const {
+        return threads_;
+    }
+
+    size_t maximum() const {
+        return threads_;
+    }
+
+    bool grow(size_t threads, size_t busy) const {
+        return false;
+    }
+
+private:
+    size_t threads_;
+};
+
+/**
+ * Growth policy: consumers pool grows up to a maximum when every consumer is busy
+ */
+struct ElasticPool {
+    static constexpr bool Elastic = true;
+
+    /**
+     * @param threads number of initial consumer threads (minimum 1)
+     * @param maxThreads maximum number of consumer threads (at least initial ones)
+     */
+    ElasticPool(size_t threads, size_t maxThreads) : threads_(threads ? threads:1), max_threads_(std::max(threads_, maxThreads)) {}
+
+    size_t initial() const {
+        return threads_;
+    }
+
+    size_t maximum() const {
+        return max_threads_;
+    }
+
+    bool grow(size_t threads, size_t busy) const {
+        return threads < max_threads_ && busy >= threads;
+    }
+
+private:
+    size_t threads_;
+    size_t max_threads_;
+};
+
+/**
+ * Task type to dispatch streams with the policy-based dispatcher
+ */
+struct StreamTask {
+    std::shared_ptr<StreamIf> stream;
+
+    void operator()(bool busyConsumers, int queueSize) {
+        stream->process(busyConsumers, queueSize);
+    }
+
+    void processLapse(unsigned long long lapse) {
+        stream->processLapse(lapse);
+    }
+};
+
+/**
+ * Policy-based queue dispatcher (header-only)
+ *
+ * FIFO queue of tasks delivered to a pool of consumer threads, where every
+ * behavior is a compile-time policy, so the hot path is inlined and only the
+ * selected features are paid for (i.e. a lock-free queue with no timing, a
+ * fixed pool and a concrete task type without virtual calls):
+ *
+ * - Task: default constructible and movable, called as task(), or as
+ *   task(busyConsumers, queueSize) when it accepts the congestion arguments
+ *   of StreamIf::process(). Consumers reset it after processing.
+ * - QueuePolicy: pending tasks storage (LockedQueue or LockFreeQueue).
+ * - WaitPolicy: how idle consumers wait (BlockingWait or SpinWait).
+ * - TimingPolicy: per task measurements (NoTiming or LapseTiming).
+ * - GrowthPolicy: pool sizing (FixedPool or ElasticPool).
+ *
+ * QueueDispatcher remains the runtime-configured dispatcher, with admission
+ * policies, priority classes, key lanes, deadlines, timers, metrics and the
+ * rest of features selected through Settings. Both are built on the same
+ * storage and parking primitives (Fifo, MpmcRing, Sleepers and spinUntil()).
+ *
+ * @see ert::queuedispatcher::QueueDispatcher
+ */
+template <typename Task, template <typename> class QueuePolicy = LockedQueue, typename WaitPolicy = BlockingWait,
+          typename TimingPolicy = NoTiming, typename GrowthPolicy = FixedPool>
+class BasicQueueDispatcher
+{
+public:
+    /** Constructor
+     *
+     * @param name queue name/identifier
+     * @param growth consumers pool sizing
+     * @param capacity queue capacity (see queue policy)
+     */
+    explicit BasicQueueDispatcher(std::string name, GrowthPolicy growth = GrowthPolicy(), size_t capacity = 0) :
+        name_(std::move(name)), queue_(capacity), growth_(std::move(growth)) {
+        threads_.reserve(growth_.maximum());
+        for (size_t i = 0; i < growth_.initial(); i++) threads_.emplace_back(&BasicQueueDispatcher::consumer, this);
+        num_threads_.store(threads_.size());
+    }
+
+    ~BasicQueueDispatcher() {
+        // Pending tasks are discarded. Pool is taken under its lock and joined without it,
+        // as consumers could be waiting for the lock to grow it (growth stops once stopped):
+        wait_.stop();
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> guard(pool_lock_);
+            threads.swap(threads_);
+        }
+        for (auto &thread: threads) thread.join();
+    }
+
+    // Deleted operations
+    BasicQueueDispatcher(const BasicQueueDispatcher&) = delete;
+    BasicQueueDispatcher& operator=(const BasicQueueDispatcher&) = delete;
+
+    /**
+     * Adds work to the queue
+     *
+     * @param task task moved into the queue
+     *
+     * @return false if the queue is full (task is untouched)
+     */
+    bool tryDispatch(Task &&task) {
+        if constexpr (GrowthPolicy::Elastic) grow();
+
+        if (!queue_.tryPush(std::move(task))) return false;
+        wait_.notify();
+        return true;
+    }
+
+    /**
+     * Adds work to the queue, waiting for room when it is full
+     *
+     * @param task task moved into the queue
+     */
+    void dispatch(Task task) {
+        while (!tryDispatch(std::move(task))) std::this_thread::yield();
+    }
+
+    /** Number of busy threads */
+    int getBusyThreads() const {
+        return busy_threads_.load();
+    }
+
+    /** Current available threads */
+    int getThreads() const {
+        return num_threads_.load();
+    }
+
+    /** Maximum threads reachable */
+    int getMaxThreads() const {
+        return growth_.maximum();
+    }
+
+    /** Queue size */
+    int getSize() const {
+        return queue_.size();
+    }
+
+    /** Queue name */
+    const std::string &getName() const {
+        return name_;
+    }
+
+private:
+    std::string name_;
+    QueuePolicy<Task> queue_;
+    WaitPolicy wait_;
+    TimingPolicy timing_;
+    GrowthPolicy growth_;
+
+    std::mutex pool_lock_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> num_threads_{0};
+    std::atomic<size_t> busy_threads_{0};
+
+    void consumer() {
+        Task task;
+        while (!wait_.stopped())
+        {
+            if (!queue_.tryPop(task))
+            {
+                if (!wait_.wait([this] { return !queue_.empty(); })) break;
+                continue;
+            }
+
+            busy_threads_++;
+
+            // Backlog left behind could still need more consumers:
+            if constexpr (GrowthPolicy::Elastic) {
+                if (!queue_.empty()) grow();
+            }
+
+            timing_.process(task, [this, &task] {
+                if constexpr (std::is_invocable<Task&, bool, int>::value) {
+                    // No idle consumers, and no margin to create new ones:
+                    size_t threads = num_threads_.load();
+                    task(busy_threads_.load() >= threads && threads == growth_.maximum(), int(queue_.size()));
+                }
+                else task();
+            });
+            task = Task();
+            busy_threads_--;
+        }
+    }
+
+    void grow() {
+        // Cheap check first (no lock):
+        if (!growth_.grow(num_threads_.load(), busy_threads_.load())) return;
+
+        std::lock_guard<std::mutex> guard(pool_lock_);
+        if (wait_.stopped() || !growth_.grow(threads_.size(), busy_threads_.load())) return; // concurrent growth
+        threads_.emplace_back(&BasicQueueDispatcher::consumer, this);
+        num_threads_.store(threads_.size());
+    }
+};
+
+}
+}
+
@@ -0,0 +1,159 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/**
+ * Move-only type-erased void() callable with small buffer optimization
+ *
+ * Callables up to InlineSize bytes (and nothrow movable) are stored inline,
+ * so no heap allocation is done for them; bigger captures fall back to the
+ * heap. A single indirect call is done to invoke the callable.
+ */
+class Callable
+{
+public:
+    /** Inline storage size */
+    static constexpr size_t InlineSize = 64;
+
+    Callable() noexcept {}
+
+    template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Callable>::value>::type>
+    Callable(F &&f) {
+        using Fn = typename std::decay<F>::type;
+        if constexpr (fitsInline<Fn>()) {
+            new (&storage_) Fn(std::forward<F>(f));
+            ops_ = &inline_ops<Fn>;
+        }
+        else {
+            *reinterpret_cast<Fn**>(&storage_) = new Fn(std::forward<F>(f));
+            ops_ = &heap_ops<Fn>;
+        }
+    }
+
+    Callable(Callable &&other) noexcept {
+        take(other);
+    }
+
+    Callable &operator=(Callable &&other) noexcept {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    ~Callable() {
+        reset();
+    }
+
+    // Deleted operations
+    Callable(const Callable&) = delete;
+    Callable& operator=(const Callable&) = delete;
+
+    /** Invokes the callable */
+    void operator()() {
+        ops_->invoke(&storage_);
+    }
+
+    /** A callable is stored */
+    explicit operator bool() const {
+        return ops_ != nullptr;
+    }
+
+    /** Destroys the stored callable */
+    void reset() {
+        if (ops_) {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    /** Callable type is stored without heap allocation */
+    template <typename Fn>
+    static constexpr bool fitsInline() {
+        return sizeof(Fn) <= InlineSize && alignof(Fn) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void *storage);
+        void (*move)(void *from, void *to);
+        void (*destroy)(void *storage);
+    };
+
+    template <typename Fn>
+    static constexpr Ops inline_ops = {
+        [](void *storage) { (*static_cast<Fn*>(storage))(); },
+        [](void *from, void *to) { new (to) Fn(std::move(*static_cast<Fn*>(from))); static_cast<Fn*>(from)->~Fn(); },
+        [](void *storage) { static_cast<Fn*>(storage)->~Fn(); }
+    };
+
+    template <typename Fn>
+    static constexpr Ops heap_ops = {
+        [](void *storage) { (**static_cast<Fn**>(storage))(); },
+        [](void *from, void *to) { *static_cast<Fn**>(to) = *static_cast<Fn**>(from); },
+        [](void *storage) { delete *static_cast<Fn**>(storage); }
+    };
+
+    alignas(std::max_align_t) unsigned char storage_[InlineSize];
+    const Ops *ops_ = nullptr;
+
+    void take(Callable &other) {
+        if (other.ops_) {
+            other.ops_->move(&other.storage_, &storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+};
+
+}
+}
+
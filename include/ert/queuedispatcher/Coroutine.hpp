@@ -0,0 +1,296 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// C++20 coroutines support (this header is empty for older standards):
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include <ert/queuedispatcher/QueueDispatcher.hpp>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/**
+ * Lazy coroutine task which may be awaited from another coroutine, or spawned on a dispatcher
+ *
+ * A handler written as a coroutine holds no consumer thread while it is suspended: it yields
+ * the thread on every co_await, and is resumed by the dispatcher (see QueueDispatcher::schedule()
+ * and Completion):
+ *
+ * @code
+ * CoTask<> handle(QueueDispatcher &queue, Request request) {
+ *     Completion<Response> response(queue);
+ *     backend.send(request, [&response](Response r) { response.complete(std::move(r)); });
+ *     reply(co_await response); // resumed on a consumer thread
+ * }
+ *
+ * spawn(queue, handle(queue, request));
+ * @endcode
+ *
+ * @see ert::queuedispatcher::spawn()
+ */
+template <typename T = void>
+class CoTask;
+
+namespace detail
+{
+template <typename T>
+struct CoTaskPromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+    bool detached = false;
+
+    std::suspend_always initial_suspend() noexcept {
+        return {};
+    }
+
+    // Awaiting coroutine continues on this thread (symmetric transfer), and spawned tasks release themselves:
+    struct FinalAwaiter {
+        bool await_ready() noexcept {
+            return false;
+        }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            auto &promise = handle.promise();
+            if (promise.detached) {
+                if (promise.exception) std::terminate(); // nobody could handle it (as with std::thread)
+                handle.destroy();
+                return std::noop_coroutine();
+            }
+            return promise.continuation ? promise.continuation:std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept {
+        return {};
+    }
+
+    void unhandled_exception() {
+        exception = std::current_exception();
+    }
+};
+
+template <typename T>
+struct CoTaskPromise : CoTaskPromiseBase<T> {
+    std::optional<T> value;
+
+    CoTask<T> get_return_object();
+
+    template <typename U>
+    void return_value(U &&result) {
+        value.emplace(std::forward<U>(result));
+    }
+
+    T result() {
+        if (this->exception) std::rethrow_exception(this->exception);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct CoTaskPromise<void> : CoTaskPromiseBase<void> {
+    CoTask<void> get_return_object();
+
+    void return_void() {}
+
+    void result() {
+        if (exception) std::rethrow_exception(exception);
+    }
+};
+}
+
+template <typename T>
+class CoTask
+{
+public:
+    using promise_type = detail::CoTaskPromise<T>;
+
+    explicit CoTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    CoTask(CoTask &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+    CoTask &operator=(CoTask &&other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    ~CoTask() {
+        if (handle_) handle_.destroy();
+    }
+
+    // Deleted operations
+    CoTask(const CoTask&) = delete;
+    CoTask& operator=(const CoTask&) = delete;
+
+    /** Starts the task (lazy) and suspends the awaiting coroutine until it finishes */
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+
+    T await_resume() {
+        return handle_.promise().result();
+    }
+
+    /** Releases the coroutine, which destroys itself when finished (see spawn()) */
+    std::coroutine_handle<promise_type> detach() {
+        handle_.promise().detached = true;
+        return std::exchange(handle_, nullptr);
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail
+{
+template <typename T>
+CoTask<T> CoTaskPromise<T>::get_return_object() {
+    return CoTask<T>(std::coroutine_handle<CoTaskPromise<T>>::from_promise(*this));
+}
+
+inline CoTask<void> CoTaskPromise<void>::get_return_object() {
+    return CoTask<void>(std::coroutine_handle<CoTaskPromise<void>>::from_promise(*this));
+}
+}
+
+/**
+ * Starts a task on a consumer thread of the dispatcher, detached from the caller
+ *
+ * The coroutine frame is released when the task finishes. Exceptions escaping the task terminate
+ * the program (as with std::thread). As any coroutine resumption, the start of the task is never
+ * discarded by the overload policy (see QueueDispatcher::resume()).
+ *
+ * @param dispatcher queue dispatcher
+ * @param task coroutine task
+ * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+ */
+inline void spawn(QueueDispatcher &dispatcher, CoTask<void> task, int priority = 0)
+{
+    dispatcher.resume(task.detach(), priority);
+}
+
+/**
+ * One-shot result bridge from callback based APIs to coroutines
+ *
+ * The awaiting coroutine is re-enqueued on the dispatcher when the result is completed
+ * (from any thread, i.e. an I/O one), so it continues on a consumer thread. When the
+ * result is already there, co_await does not suspend at all.
+ */
+template <typename T = void>
+class Completion
+{
+public:
+    /** Constructor
+     *
+     * @param dispatcher queue dispatcher where the awaiting coroutine is resumed
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     */
+    explicit Completion(QueueDispatcher &dispatcher, int priority = 0) : dispatcher_(dispatcher), priority_(priority) {}
+
+    // Deleted operations
+    Completion(const Completion&) = delete;
+    Completion& operator=(const Completion&) = delete;
+
+    /** Sets the result (once) and resumes the awaiting coroutine */
+    template <typename... Args>
+    void complete(Args&&... args) {
+        value_.emplace(std::forward<Args>(args)...);
+        resume();
+    }
+
+    bool await_ready() const noexcept {
+        return state_.load(std::memory_order_acquire) == Done;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+        handle_ = handle;
+        int expected = Empty;
+        return state_.compare_exchange_strong(expected, Waiting, std::memory_order_acq_rel); // completed meanwhile: no suspension
+    }
+
+    T await_resume() {
+        if constexpr (!std::is_void_v<T>) return std::move(*value_);
+    }
+
+private:
+    enum { Empty, Waiting, Done };
+
+    struct Nothing {
+        void emplace() {}
+    };
+
+    QueueDispatcher &dispatcher_;
+    int priority_;
+    std::conditional_t<std::is_void_v<T>, Nothing, std::optional<T>> value_;
+    std::coroutine_handle<> handle_;
+    std::atomic<int> state_{Empty};
+
+    void resume() {
+        // Coroutine (owning this object) may be gone as soon as it is resumed: members are read before
+        QueueDispatcher &dispatcher = dispatcher_;
+        int priority = priority_;
+        if (state_.exchange(Done, std::memory_order_acq_rel) != Waiting) return;
+
+        dispatcher.resume(handle_, priority);
+    }
+};
+
+}
+}
+
+#endif
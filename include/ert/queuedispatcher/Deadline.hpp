@@ -0,0 +1,81 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <chrono>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/**
+ * Task deadline: steady clock time point, or time to live since dispatch
+ *
+ * Tasks whose deadline has passed when they are dequeued are not processed
+ * (see StreamIf::onExpired()).
+ */
+class Deadline
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /** No deadline */
+    Deadline() : at_(Clock::time_point::max()) {}
+
+    /** Deadline at a time point */
+    Deadline(Clock::time_point at) : at_(at) {}
+
+    /** Deadline after a time to live */
+    template <typename Rep, typename Period>
+    Deadline(std::chrono::duration<Rep, Period> ttl) : at_(Clock::now() + std::chrono::duration_cast<Clock::duration>(ttl)) {}
+
+    /** Deadline time point (maximum time point when there is no deadline) */
+    Clock::time_point at() const {
+        return at_;
+    }
+
+private:
+    Clock::time_point at_;
+};
+
+}
+}
+
@@ -0,0 +1,147 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <condition_variable>
+#include <memory>
+#include <chrono>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+class QueueDispatcher;
+class TimerService;
+
+/**
+ * Shared pool of consumer threads for virtual queues
+ *
+ * Queue dispatchers created on top of an executor (virtual queues) own no
+ * threads: their pending tasks are processed in turns by the executor
+ * workers, so the number of threads follows the number of cores instead of
+ * the number of queues. A virtual queue is scheduled for as many turns as
+ * its pending work needs, up to its concurrency cap (executor workers
+ * serving it at the same time, see Settings::maxThreads), and each turn
+ * drains up to its weight times the batch size (see Settings::weight), so a
+ * backlogged queue cannot starve the others: busy queues are served in
+ * weighted round-robin. Delayed and periodic work of every virtual queue is
+ * driven by a single timer thread of the executor.
+ *
+ * The executor must outlive its queues (they share its ownership), and a
+ * virtual queue must not be destroyed from one of its own tasks.
+ *
+ * @see ert::queuedispatcher::QueueDispatcher
+ */
+class Executor
+{
+public:
+    /** Constructor
+     *
+     * @param name Executor name/identifier
+     * @param threads number of worker threads (zero or negative: one per hardware thread)
+     * @param timerResolution tick of the timing wheel shared by virtual queues (see Settings::timerResolution)
+     */
+    explicit Executor(std::string name, int threads = 0, std::chrono::microseconds timerResolution = std::chrono::microseconds(1000));
+    ~Executor();
+
+    // Deleted operations
+    Executor(const Executor& rhs) = delete;
+    Executor& operator=(const Executor& rhs) = delete;
+    Executor(Executor&& rhs) = delete;
+    Executor& operator=(Executor&& rhs) = delete;
+
+    /** Number of worker threads */
+    int getThreads() const {
+        return threads_.size();
+    }
+
+    /** Number of busy worker threads */
+    int getBusyThreads() const {
+        return busy_threads_.load();
+    }
+
+    /** Number of virtual queues attached */
+    size_t getQueues() const;
+
+    /** Executor name */
+    const std::string &getName() const {
+        return name_;
+    }
+
+private:
+    friend class QueueDispatcher;
+
+    // Scheduling state of a virtual queue (protected by lock_):
+    struct Member {
+        QueueDispatcher *queue;
+        size_t cap; // concurrent turns
+        size_t running = 0; // turns being served
+        size_t queued = 0; // turns waiting in ready queue
+        bool detached = false;
+    };
+
+    std::string name_;
+    mutable std::mutex lock_;
+    std::condition_variable cv_;
+    std::condition_variable detach_cv_;
+    std::deque<Member*> ready_; // turns pending, in round-robin order
+    std::vector<std::unique_ptr<Member>> members_;
+    std::vector<std::thread> threads_;
+    std::atomic<int> busy_threads_{0};
+    bool quit_ = false;
+    std::unique_ptr<TimerService> timers_; // shared by virtual queues
+
+    Member *attach(QueueDispatcher *queue, size_t cap);
+    void detach(Member *member);
+    void notify(Member *member);
+    void schedule(Member *member);
+    void worker_thread_handler(size_t index);
+};
+
+}
+}
+
@@ -0,0 +1,117 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/**
+ * Unbounded FIFO over a circular buffer
+ *
+ * Storage doubles when full and is never released while the FIFO lives, so a
+ * warmed-up FIFO pushes and pops without heap allocation (unlike std::deque,
+ * which allocates and frees chunks as the queue moves). Popped slots are reset
+ * to a default constructed value to release resources held by the element.
+ */
+template <typename T>
+class Fifo
+{
+public:
+    /** Constructor
+     *
+     * @param capacity initial capacity. Rounded up to power of two.
+     */
+    explicit Fifo(size_t capacity = 16) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        buffer_.resize(size);
+    }
+
+    /** Appends an element */
+    void push(T &&value) {
+        if (size_ == buffer_.size()) grow();
+        buffer_[(head_ + size_) & (buffer_.size() - 1)] = std::move(value);
+        size_++;
+    }
+
+    /** Oldest element */
+    T &front() {
+        return buffer_[head_];
+    }
+
+    /** Removes the oldest element */
+    void pop() {
+        buffer_[head_] = T();
+        head_ = (head_ + 1) & (buffer_.size() - 1);
+        size_--;
+    }
+
+    /** Number of elements */
+    size_t size() const {
+        return size_;
+    }
+
+    /** FIFO is empty */
+    bool empty() const {
+        return size_ == 0;
+    }
+
+private:
+    std::vector<T> buffer_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+
+    void grow() {
+        std::vector<T> buffer(buffer_.size() * 2);
+        for (size_t i = 0; i < size_; i++) buffer[i] = std::move(buffer_[(head_ + i) & (buffer_.size() - 1)]);
+        buffer_.swap(buffer);
+        head_ = 0;
+    }
+};
+
+}
+}
+
@@ -0,0 +1,192 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <ert/queuedispatcher/MpmcRing.hpp>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/**
+ * Flight recorder of sampled task lifecycles and pool resize events
+ *
+ * Every consumer records into its own ring of events (single writer, no
+ * locks: a sequence number per slot lets readers skip events overwritten
+ * while copying them), so the last events are always at hand and recording
+ * costs a few relaxed stores per sampled task. Pool events are recorded into
+ * an extra ring by the thread resizing the pool.
+ *
+ * Events of a time window are exported as Chrome trace JSON (chrome://tracing
+ * or ui.perfetto.dev): queue wait as async spans, processing as complete
+ * spans on the consumer track, and pool size as a counter.
+ */
+class FlightRecorder
+{
+public:
+    /** Event kinds */
+    enum class Kind : std::uint8_t {
+        Task, /**< task processed */
+        Grow, /**< consumer thread started */
+        Shrink /**< consumer thread retired */
+    };
+
+    /** Constructor
+     *
+     * @param name traced queue name (trace process name)
+     * @param consumers number of consumer rings (one more ring is added for pool events)
+     * @param capacity events kept per ring. Rounded up to power of two
+     * @param sampling ratio (0..1] of tasks recorded (i.e. 0.01 records one of every hundred tasks)
+     */
+    FlightRecorder(std::string name, size_t consumers, size_t capacity, double sampling);
+    ~FlightRecorder();
+
+    // Deleted operations
+    FlightRecorder(const FlightRecorder& rhs) = delete;
+    FlightRecorder& operator=(const FlightRecorder& rhs) = delete;
+
+    /** Sampling decision for a new task (counted per producer thread) */
+    bool sample() const {
+        static thread_local std::uint64_t sequence = 0;
+        return (sequence++ % period_) == 0;
+    }
+
+    /**
+     * Records a processed task (only from the consumer owning the ring)
+     *
+     * @param consumer consumer ring
+     * @param enqueue task admission time
+     * @param dequeue time when the task was taken from the queue
+     * @param start processing start time
+     * @param end processing end time
+     * @param depth queue size when processing ended
+     * @param priority task priority class
+     */
+    void record(size_t consumer, std::chrono::steady_clock::time_point enqueue, std::chrono::steady_clock::time_point dequeue,
+                std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, size_t depth, unsigned priority);
+
+    /**
+     * Records a pool resize (only from one thread at a time)
+     *
+     * @param kind grow or shrink
+     * @param threads pool size after the event
+     */
+    void record(Kind kind, size_t threads);
+
+    /**
+     * Chrome trace JSON with the events of the last time window
+     *
+     * @param window time window before now (zero: every event kept)
+     */
+    std::string asChromeTrace(std::chrono::nanoseconds window) const;
+
+    /**
+     * Writes the Chrome trace JSON into a file
+     *
+     * @param path output file (overwritten)
+     * @param window time window before now (zero: every event kept)
+     *
+     * @return false if the file could not be written
+     */
+    bool dump(const std::string &path, std::chrono::nanoseconds window) const;
+
+    /**
+     * Writes the Chrome trace JSON into a file whenever a signal is received (i.e. SIGUSR2).
+     * The signal handler only wakes up a watcher thread, which writes the file. Any previous
+     * handler of the signal is replaced (Linux only)
+     *
+     * @param signum signal number
+     * @param path output file (overwritten on every signal)
+     * @param window time window before the signal (zero: every event kept)
+     *
+     * @return false if not supported, already watching or no room for more watchers
+     */
+    bool dumpOnSignal(int signum, const std::string &path, std::chrono::nanoseconds window);
+
+private:
+    // Event slot (sequence is zero while being written, and ring position plus one when written):
+    struct Slot {
+        std::atomic<std::uint64_t> sequence{0};
+        std::atomic<std::uint64_t> enqueue{0}; // nanoseconds since origin (pool events: time)
+        std::atomic<std::uint64_t> dequeue{0};
+        std::atomic<std::uint64_t> start{0};
+        std::atomic<std::uint64_t> end{0};
+        std::atomic<std::uint64_t> info{0}; // kind | priority << 8 | depth (or threads) << 32
+    };
+
+    struct alignas(CacheLineSize) Ring {
+        std::atomic<std::uint64_t> head{0};
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    // Event copied out of a ring:
+    struct Event {
+        size_t ring;
+        std::uint64_t enqueue, dequeue, start, end, info;
+    };
+
+    std::string name_;
+    std::chrono::steady_clock::time_point origin_;
+    std::uint64_t period_;
+    size_t mask_;
+    size_t consumers_;
+    std::unique_ptr<Ring[]> rings_; // consumers plus pool ring
+
+    // Signal watcher (see dumpOnSignal()):
+    int watcher_slot_ = -1;
+    int watcher_pipe_ = -1; // read end
+    std::thread watcher_;
+
+    std::uint64_t since_origin(std::chrono::steady_clock::time_point time) const;
+    void write(size_t ring, std::uint64_t enqueue, std::uint64_t dequeue, std::uint64_t start, std::uint64_t end, std::uint64_t info);
+};
+
+}
+}
+
@@ -0,0 +1,170 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <ert/queuedispatcher/Fifo.hpp>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/**
+ * FIFO lanes of the keys with work in flight
+ *
+ * Keys are kept in an open addressing table (linear probing, backward shift deletion, so
+ * there are no tombstones) and their lanes in a pool: a closed key gives its lane, storage
+ * included, to the next key opened. Table, pool and lanes only grow, so once warmed up,
+ * keys go from idle to active and back without heap allocation (unlike node based maps).
+ * Not thread safe.
+ */
+template <typename T>
+class KeyLanes
+{
+public:
+    /** Constructor
+     *
+     * @param capacity initial number of keys. Rounded up to power of two.
+     */
+    explicit KeyLanes(size_t capacity = 8) {
+        size_t size = 2;
+        while (size < 2 * capacity) size <<= 1;
+        slots_.resize(size);
+    }
+
+    /** Lane of an open key (nullptr when the key is not open). Invalidated by open() */
+    Fifo<T> *find(std::uint64_t key) {
+        for (size_t i = home(key);; i = next(i)) {
+            const Slot &slot = slots_[i];
+            if (slot.lane == Empty) return nullptr;
+            if (slot.key == key) return &lanes_[slot.lane];
+        }
+    }
+
+    /** Opens a key (not open yet) with an empty lane */
+    void open(std::uint64_t key) {
+        if (2 * (size_ + 1) > slots_.size()) grow();
+
+        std::uint32_t lane;
+        if (free_.empty()) {
+            lane = lanes_.size();
+            lanes_.emplace_back(1);
+        }
+        else {
+            lane = free_.back();
+            free_.pop_back();
+        }
+
+        insert(key, lane);
+        size_++;
+    }
+
+    /** Closes a key, whose lane must be empty, and keeps the lane for the next key opened */
+    void close(std::uint64_t key) {
+        size_t hole = home(key);
+        for (;; hole = next(hole)) {
+            if (slots_[hole].lane == Empty) return;
+            if (slots_[hole].key == key) break;
+        }
+        free_.push_back(slots_[hole].lane);
+
+        // Entries probed past the hole move back into it, unless that would put them before their home slot:
+        for (size_t i = next(hole); slots_[i].lane != Empty; i = next(i)) {
+            size_t h = home(slots_[i].key);
+            bool movable = (hole <= i) ? (h <= hole || h > i):(h <= hole && h > i);
+            if (movable) {
+                slots_[hole] = slots_[i];
+                hole = i;
+            }
+        }
+        slots_[hole].lane = Empty;
+        size_--;
+    }
+
+    /** Number of open keys */
+    size_t size() const {
+        return size_;
+    }
+
+private:
+    static constexpr std::uint32_t Empty = ~std::uint32_t(0);
+
+    struct Slot {
+        std::uint64_t key = 0;
+        std::uint32_t lane = Empty;
+    };
+
+    std::vector<Slot> slots_; // power of two, at most half full
+    std::vector<Fifo<T>> lanes_;
+    std::vector<std::uint32_t> free_; // lanes not in use
+    size_t size_ = 0;
+
+    size_t home(std::uint64_t key) const {
+        // Fibonacci hashing, folded so that the low bits depend on the whole key:
+        std::uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+        return (hash ^ (hash >> 32)) & (slots_.size() - 1);
+    }
+
+    size_t next(size_t i) const {
+        return (i + 1) & (slots_.size() - 1);
+    }
+
+    void insert(std::uint64_t key, std::uint32_t lane) {
+        size_t i = home(key);
+        while (slots_[i].lane != Empty) i = next(i);
+        slots_[i].key = key;
+        slots_[i].lane = lane;
+    }
+
+    void grow() {
+        std::vector<Slot> slots(slots_.size() * 2);
+        slots_.swap(slots);
+        for (const Slot &slot: slots) {
+            if (slot.lane != Empty) insert(slot.key, slot.lane);
+        }
+    }
+};
+
+}
+}
@@ -0,0 +1,107 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/**
+ * Adaptive in-flight limit (tasks pending or being processed) which holds a queue wait target
+ *
+ * AIMD over sampling windows of about one limit of tasks: the limit grows by one while
+ * the average queue wait is under target (and the limit was actually approached), and
+ * it is cut by a multiplicative backoff when the target is exceeded. The cut goes deeper
+ * (up to twice the backoff) when the Little's law estimation (throughput by target plus
+ * service time) is lower, so the limit converges faster after a load step.
+ *
+ * Samples come from every consumer thread: they are only aggregated when the limiter is
+ * not busy with another one, so contention just skips samples.
+ */
+class AdaptiveLimiter
+{
+public:
+    /** Constructor
+     *
+     * @param target queue wait target
+     * @param initial initial limit
+     * @param minimum lowest limit
+     */
+    AdaptiveLimiter(std::chrono::nanoseconds target, size_t initial, size_t minimum);
+
+    /**
+     * Accounts a processed task
+     *
+     * @param queueWait nanoseconds since dispatch until processing start
+     * @param service processing nanoseconds
+     * @param inFlight tasks pending or being processed when it started
+     */
+    void sample(unsigned long long queueWait, unsigned long long service, size_t inFlight);
+
+    /** Current limit */
+    size_t limit() const {
+        return limit_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr double Backoff = 0.9;
+
+    const double target_; // nanoseconds
+    const size_t minimum_;
+    std::atomic<size_t> limit_;
+
+    // Current window (protected by lock_):
+    std::mutex lock_;
+    std::chrono::steady_clock::time_point since_;
+    size_t samples_ = 0;
+    double wait_ = 0;
+    double service_ = 0;
+    size_t peak_ = 0;
+};
+
+}
+}
+
@@ -0,0 +1,160 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <ert/queuedispatcher/MpmcRing.hpp>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/**
+ * Latency histogram with log2 buckets (bucket i holds values up to 2^(i+10) nanoseconds,
+ * i.e. from 1 microsecond to 8.6 seconds, and the last one is unbounded)
+ *
+ * Single writer and lock-free: each consumer thread records into its own histogram
+ * with plain relaxed stores, and readers aggregate them into a snapshot.
+ */
+class LatencyHistogram
+{
+public:
+    /** Number of buckets (last one is unbounded) */
+    static constexpr size_t Buckets = 25;
+
+    /** Histogram values at some point */
+    struct Snapshot {
+        std::array<std::uint64_t, Buckets> buckets{}; /**< non cumulative counts */
+        std::uint64_t count = 0;
+        std::uint64_t sum = 0; /**< nanoseconds */
+
+        /** Accumulates another snapshot */
+        void add(const Snapshot &other) {
+            for (size_t i = 0; i < Buckets; i++) buckets[i] += other.buckets[i];
+            count += other.count;
+            sum += other.sum;
+        }
+    };
+
+    /** Records a value (owner thread only) */
+    void record(std::uint64_t ns) {
+        size_t i = bucket(ns);
+        buckets_[i].store(buckets_[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum_.store(sum_.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+        count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    /** Current values (any thread) */
+    void collect(Snapshot &snapshot) const {
+        Snapshot mine;
+        mine.count = count_.load(std::memory_order_relaxed);
+        mine.sum = sum_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < Buckets; i++) mine.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        snapshot.add(mine);
+    }
+
+    /** Bucket for a value */
+    static size_t bucket(std::uint64_t ns) {
+        size_t i = 0;
+        for (std::uint64_t bound = 1024; i < Buckets - 1 && ns > bound; bound <<= 1) i++;
+        return i;
+    }
+
+    /** Bucket upper bound in seconds (infinity for the last one) */
+    static double upperBound(size_t i);
+
+private:
+    std::array<std::atomic<std::uint64_t>, Buckets> buckets_{};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> count_{0};
+};
+
+/**
+ * Consumer thread metrics (single writer, padded to avoid false sharing between consumers)
+ */
+struct alignas(CacheLineSize) ConsumerMetrics {
+    LatencyHistogram queueWait; /**< time since dispatch until processing starts */
+    LatencyHistogram service;   /**< processing time */
+    std::atomic<std::uint64_t> busy{0}; /**< nanoseconds spent processing */
+    std::atomic<size_t> peakDepth{0};   /**< highest queue depth seen when popping */
+
+    /** Accumulates a value (owner thread only) */
+    static void add(std::atomic<std::uint64_t> &counter, std::uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * Queue dispatcher metrics at some point
+ *
+ * @see ert::queuedispatcher::QueueDispatcher::getMetrics()
+ */
+struct MetricsSnapshot {
+    std::uint64_t enqueued = 0;  /**< tasks admitted */
+    std::uint64_t processed = 0; /**< tasks processed */
+    std::uint64_t rejected = 0;  /**< tasks discarded by the overload policy */
+    std::uint64_t expired = 0;   /**< tasks discarded because their deadline passed (counted even with metrics disabled) */
+    size_t depth = 0;            /**< pending tasks */
+    size_t peakDepth = 0;        /**< highest number of pending tasks */
+    size_t threads = 0;          /**< consumer threads */
+    size_t busyThreads = 0;      /**< consumer threads processing tasks */
+    size_t limit = 0;            /**< adaptive in-flight limit (zero: adaptive limiter disabled) */
+    double utilization = 0;      /**< ratio of consumers time spent processing since previous snapshot */
+    double busySeconds = 0;      /**< total time spent processing */
+    LatencyHistogram::Snapshot queueWait;
+    LatencyHistogram::Snapshot service;
+
+    /**
+     * Prometheus text exposition format
+     *
+     * @param queue value for the 'queue' label of every metric
+     */
+    std::string asPrometheus(const std::string &queue) const;
+};
+
+}
+}
+
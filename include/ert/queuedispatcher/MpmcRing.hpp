@@ -0,0 +1,179 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/** Cache line size assumed for padding */
+constexpr size_t CacheLineSize = 64;
+
+/**
+ * Bounded multi-producer/multi-consumer lock-free ring buffer
+ *
+ * Every cell carries a sequence number which tells producers and consumers
+ * whether the cell is ready to be written or read for the current lap, so
+ * that only one compare-and-swap over the head (or tail) counter is needed
+ * per operation (D. Vyukov's bounded MPMC queue). Counters and cells are
+ * padded to the cache line to avoid false sharing between producers and
+ * consumers.
+ *
+ * Capacity is rounded up to the next power of two.
+ */
+template <typename T>
+class MpmcRing
+{
+public:
+    /** Constructor
+     *
+     * @param capacity maximum number of elements stored. Rounded up to power of two (minimum 2).
+     */
+    explicit MpmcRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; i++) cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // Deleted operations
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    /**
+     * Pushes an element
+     *
+     * @param value element moved into the ring on success
+     *
+     * @return false if the ring is full (value is untouched)
+     */
+    bool tryPush(T &&value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                return false; // full
+            }
+            else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Pops the oldest element
+     *
+     * @param value destination for the element
+     *
+     * @return false if the ring is empty (or the oldest element is still being published)
+     */
+    bool tryPop(T &value) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                return false; // empty
+            }
+            else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Number of elements (claimed by producers and not yet claimed by consumers) */
+    size_t size() const {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        return (tail > head) ? (tail - head):0;
+    }
+
+    /** Ring is empty */
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /** Ring capacity (power of two) */
+    size_t capacity() const {
+        return mask_ + 1;
+    }
+
+private:
+    struct alignas(CacheLineSize) Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    alignas(CacheLineSize) std::atomic<size_t> tail_{0};
+    alignas(CacheLineSize) std::atomic<size_t> head_{0};
+    alignas(CacheLineSize) size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+};
+
+}
+}
+
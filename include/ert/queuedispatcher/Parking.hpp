@@ -0,0 +1,133 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/** Busy wait hint to the CPU (lower power, and sibling hyperthread gets the pipeline) */
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+/**
+ * Polls a condition before parking: pausing the CPU for the first half of the iterations,
+ * and yielding for the second one
+ *
+ * @return true as soon as the condition holds, false when iterations are exhausted
+ */
+template <typename Ready>
+bool spinUntil(unsigned iterations, Ready &&ready)
+{
+    for (unsigned i = 0; i < iterations; i++)
+    {
+        if (ready()) return true;
+        if (i < iterations / 2) cpuRelax();
+        else std::this_thread::yield();
+    }
+    return false;
+}
+
+/**
+ * Consumers parked on a condition variable, so producers only notify when some of them is parked
+ *
+ * Consumers register before checking for pending work, and producers check the count after
+ * publishing theirs (both sides fenced), so a producer either sees a consumer parked or the
+ * consumer sees its work.
+ */
+class Sleepers
+{
+public:
+    /** Registers a consumer about to park (before checking for pending work) */
+    void park() {
+        count_.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    /** Unregisters a consumer done with waiting */
+    void unpark() {
+        count_.fetch_sub(1);
+    }
+
+    /** Number of parked consumers */
+    size_t count() const {
+        return count_.load();
+    }
+
+    /**
+     * Wakes up parked consumers, if any (after publishing work)
+     *
+     * @param lock mutex consumers wait with (taken and released, so the wakeup is not lost
+     * between their check for pending work and their wait)
+     * @param cv condition variable consumers wait on
+     * @param count number of consumers needed
+     */
+    void wake(std::mutex &lock, std::condition_variable &cv, size_t count = 1) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        size_t sleepers = count_.load();
+        if (sleepers == 0) return;
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+        }
+
+        if (count >= sleepers) cv.notify_all();
+        else while (count--) cv.notify_one();
+    }
+
+private:
+    std::atomic<size_t> count_{0};
+};
+
+}
+}
@@ -43,34 +43,121 @@ SOFTWARE.
 #include <functional>
 #include <vector>
 #include <atomic>
-#include <queue>
 #include <mutex>
 #include <string>
 #include <condition_variable>
+#include <memory>
+#include <cstdint>
+#include <chrono>
+#include <type_traits>
 
 #include <ert/queuedispatcher/StreamIf.hpp>
+#include <ert/queuedispatcher/Settings.hpp>
+#include <ert/queuedispatcher/MpmcRing.hpp>
+#include <ert/queuedispatcher/Parking.hpp>
+#include <ert/queuedispatcher/Fifo.hpp>
+#include <ert/queuedispatcher/KeyLanes.hpp>
+#include <ert/queuedispatcher/Callable.hpp>
+#include <ert/queuedispatcher/Metrics.hpp>
+#include <ert/queuedispatcher/Limiter.hpp>
+#include <ert/queuedispatcher/Deadline.hpp>
+#include <ert/queuedispatcher/Executor.hpp>
+#include <ert/queuedispatcher/FlightRecorder.hpp>
 
 namespace ert
 {
 namespace queuedispatcher
 {
+
+class TimerService;
+
 /**
  * FIFO queue dispatcher
  *
  * FIFO queue of tasks are delivered to a fixed initial pool of threads.
  * Maximum number of threads (greater than initial provided to have sense)
  * can be specified, so the threads pool will grow when all threads available
- * are busy. If there is no more chance to grow (maximum reached, or maximum
+ * are busy (queue depth and utilization thresholds may be tuned, and idle
+ * threads may retire back to the initial pool size: see Settings). If there is no more chance to grow (maximum reached, or maximum
  * was not provided and threads pool size (initial fixed size) is exhausted),
  * congestion action can be applied: stream process() passes this as a flag to
  * be considered by the user. If no congestion control is applied, or the
  * consumption capacity is smaller than production one the queue size could
- * grow with the degradation consequence in response times.
+ * grow with the degradation consequence in response times, unless a queue
+ * capacity is configured: then overload is handled at enqueue time by the
+ * configured admission policy (reject, block, drop oldest or callback).
+ *
+ * Pending tasks are stored by default in a mutex protected FIFO. A lock-free
+ * bounded ring buffer may be selected instead (see Settings), so producers
+ * and consumers only synchronize through the ring counters, and the mutex is
+ * only used to park idle consumers. With any backend, idle consumers may
+ * poll for a while before parking, and producers only notify when some
+ * consumer is actually parked.
+ *
+ * With work-stealing backend, every consumer thread owns a local deque:
+ * tasks dispatched from inside a consumer (StreamIf::process()) are kept in
+ * the local deque of that consumer, and external tasks are distributed in a
+ * round-robin fashion. Idle consumers steal from their peers. NUMA backend
+ * works the same way with one deque per NUMA node instead of per consumer:
+ * consumers are spread over the nodes (and pinned to their CPUs), producers
+ * enqueue to the deque of the node they are running on, and consumers only
+ * steal from remote nodes when their own node has nothing pending, so task
+ * data tends to stay socket-local.
+ *
+ * Tasks dispatched with a key keep FIFO order within that key and are never
+ * processed concurrently, while different keys spread across the whole pool:
+ * only the oldest task of each key is in the queue at a time, and the next one
+ * is enqueued when it has been processed. Lanes of idle keys are recycled, so
+ * keys becoming active do not allocate once the queue is warmed up.
+ *
+ * Tasks may be dispatched with a deadline (or time to live): when it has
+ * passed by the time the task is dequeued, the task is discarded instead of
+ * processed (see StreamIf::onExpired()), so stale work is shed at the front
+ * of the queue when it backs up.
+ *
+ * Delayed and periodic work is kept in a hierarchical timing wheel (O(1)
+ * timer addition and cancellation) driven by a timer thread, started on first
+ * use, which feeds due tasks into the queue in batches. Virtual queues share
+ * the timer thread of their executor (see TimerService). Timers are not free of
+ * allocations: the wheel storage and the batch of due tasks grow up to the peak
+ * of pending and simultaneously due timers, and every periodic timer allocates
+ * its shared callable.
+ *
+ * A queue may also be created on top of a shared executor (virtual queue):
+ * then it owns no consumer threads, and its tasks are processed by the
+ * executor workers in weighted turns, up to a concurrency cap, so many
+ * queues can share a pool sized to the core count (see Executor).
+ *
+ * Besides streams, plain callables (i.e. lambdas) may be dispatched: they are
+ * stored inline in the queue slot when small enough (see Callable), so no
+ * StreamIf subclass has to be allocated for fine-grained work.
+ *
+ * Metrics may be enabled (see Settings): every consumer records the time
+ * tasks waited in the queue and their service time into its own lock-free
+ * histograms, which are only aggregated when a snapshot is requested.
+ *
+ * A flight recorder may be enabled with a sampling ratio (see Settings): the
+ * lifecycle of sampled tasks (enqueue, dequeue, processing start and end,
+ * consumer and queue depth) and pool resize events are kept in per-consumer
+ * rings, and the last ones can be dumped as Chrome trace JSON on demand or
+ * when a signal is received.
+ *
+ * An adaptive concurrency limiter may be enabled with a queue wait target
+ * (see Settings): it adapts an in-flight tasks limit from the measured queue
+ * wait and service times of all consumers, and streams receive the shedding
+ * advice in their processing context (see StreamIf::processWithContext()).
  *
  * @see ert::queuedispatcher::StreamIf
+ * @see ert::queuedispatcher::Settings
  */
 class QueueDispatcher
 {
+    // Callables accepted by dispatch() besides streams
+    template <typename F>
+    struct IsTaskCallable : std::integral_constant<bool,
+        !std::is_convertible<F, std::shared_ptr<StreamIf>>::value &&
+        std::is_invocable<typename std::decay<F>::type&>::value> {};
+
 public:
     /** Constructor
      *
@@ -79,10 +166,333 @@ public:
      * @param maxThreads maximum number of consumer threads. By default, it is equal to initial threads (freeze consumers pool size),
      */
     QueueDispatcher(std::string name, int threads, int maxThreads = -1);
+
+    /** Constructor
+     *
+     * @param name QueueDispatcher name/identifier
+     * @param settings QueueDispatcher configuration
+     */
+    QueueDispatcher(std::string name, const Settings &settings);
+
+    /** Constructor of a virtual queue, processed by the threads of a shared executor
+     *
+     * @param name QueueDispatcher name/identifier
+     * @param executor shared consumers pool (empty: the queue owns its consumer threads)
+     * @param settings QueueDispatcher configuration. Thread counts are the concurrency cap of the queue
+     * (limited to executor threads), and backend, pool resizing, placement and spin settings do not apply
+     */
+    QueueDispatcher(std::string name, std::shared_ptr<Executor> executor, const Settings &settings = Settings());
+
+    /**
+     * Destructor. Consumers complete the tasks they are processing and stop, with any backend:
+     * pending tasks (and timers) are discarded, except coroutine resumptions, which are run on
+     * the destroying thread (see resume())
+     */
     ~QueueDispatcher();
 
-    /** Adds work to the queue */
-    void dispatch(std::shared_ptr<StreamIf>);
+    /**
+     * Adds work to the queue
+     *
+     * @param st stream to process
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     */
+    void dispatch(std::shared_ptr<StreamIf> st, int priority = 0) {
+        tryDispatch(std::move(st), priority);
+    }
+
+    /**
+     * Adds work to the queue, serialized with the rest of work dispatched with the same key
+     *
+     * @param key ordering key (i.e. session or stream identifier hash). Tasks sharing the key are
+     * processed in FIFO order and never at the same time
+     * @param st stream to process
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     */
+    void dispatch(std::uint64_t key, std::shared_ptr<StreamIf> st, int priority = 0) {
+        tryDispatch(key, std::move(st), priority);
+    }
+
+    /**
+     * Adds work to the queue applying the overload policy when capacity is reached
+     *
+     * @param st stream to process
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @return false if the stream was not admitted
+     */
+    bool tryDispatch(std::shared_ptr<StreamIf> st, int priority = 0);
+
+    /**
+     * Adds work to the queue, serialized with the same key, applying the overload policy when capacity is reached
+     *
+     * @param key ordering key (see dispatch())
+     * @param st stream to process
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @return false if the stream was not admitted
+     */
+    bool tryDispatch(std::uint64_t key, std::shared_ptr<StreamIf> st, int priority = 0);
+
+    /**
+     * Adds work to the queue, which is discarded if not processed before a deadline
+     *
+     * @param st stream to process
+     * @param deadline time point or time to live (see StreamIf::onExpired())
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     */
+    void dispatch(std::shared_ptr<StreamIf> st, Deadline deadline, int priority = 0) {
+        tryDispatch(std::move(st), deadline, priority);
+    }
+
+    /**
+     * Adds work to the queue, serialized with the same key, which is discarded if not processed before a deadline
+     *
+     * @param key ordering key (see dispatch())
+     * @param st stream to process
+     * @param deadline time point or time to live (see StreamIf::onExpired())
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     */
+    void dispatch(std::uint64_t key, std::shared_ptr<StreamIf> st, Deadline deadline, int priority = 0) {
+        tryDispatch(key, std::move(st), deadline, priority);
+    }
+
+    /**
+     * Adds work to the queue with a deadline, applying the overload policy when capacity is reached
+     *
+     * @param st stream to process
+     * @param deadline time point or time to live (see StreamIf::onExpired())
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @return false if the stream was not admitted
+     */
+    bool tryDispatch(std::shared_ptr<StreamIf> st, Deadline deadline, int priority = 0);
+
+    /**
+     * Adds work to the queue with a deadline, serialized with the same key, applying the overload policy when capacity is reached
+     *
+     * @param key ordering key (see dispatch())
+     * @param st stream to process
+     * @param deadline time point or time to live (see StreamIf::onExpired())
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @return false if the stream was not admitted
+     */
+    bool tryDispatch(std::uint64_t key, std::shared_ptr<StreamIf> st, Deadline deadline, int priority = 0);
+
+    /**
+     * Adds a callable to the queue
+     *
+     * @param f move-only callable with no arguments. Stored inline up to Callable::InlineSize bytes
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     */
+    template <typename F, typename = typename std::enable_if<IsTaskCallable<F>::value>::type>
+    void dispatch(F &&f, int priority = 0) {
+        tryDispatch(std::forward<F>(f), priority);
+    }
+
+    /**
+     * Adds a callable to the queue applying the overload policy when capacity is reached
+     *
+     * @param f move-only callable with no arguments. Stored inline up to Callable::InlineSize bytes
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @return false if the callable was not admitted
+     */
+    template <typename F, typename = typename std::enable_if<IsTaskCallable<F>::value>::type>
+    bool tryDispatch(F &&f, int priority = 0) {
+        return submit(Task{nullptr, 0, false, priority_class(priority), Callable(std::forward<F>(f))});
+    }
+
+    /**
+     * Adds a callable to the queue, which is discarded if not run before a deadline
+     *
+     * @param f move-only callable with no arguments. Stored inline up to Callable::InlineSize bytes
+     * @param deadline time point or time to live
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     */
+    template <typename F, typename = typename std::enable_if<IsTaskCallable<F>::value>::type>
+    void dispatch(F &&f, Deadline deadline, int priority = 0) {
+        tryDispatch(std::forward<F>(f), deadline, priority);
+    }
+
+    /**
+     * Adds a callable to the queue with a deadline, applying the overload policy when capacity is reached
+     *
+     * @param f move-only callable with no arguments. Stored inline up to Callable::InlineSize bytes
+     * @param deadline time point or time to live
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @return false if the callable was not admitted
+     */
+    template <typename F, typename = typename std::enable_if<IsTaskCallable<F>::value>::type>
+    bool tryDispatch(F &&f, Deadline deadline, int priority = 0) {
+        return submit(Task{nullptr, 0, false, priority_class(priority), Callable(std::forward<F>(f)), {}, deadline.at()});
+    }
+
+    /** Timer identifier (see cancel()) */
+    using TimerId = std::uint64_t;
+
+    /**
+     * Adds work to the queue after a delay
+     *
+     * @param delay time until dispatch (rounded up to timer resolution, see Settings::timerResolution)
+     * @param st stream to process
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @return timer identifier. Overload policy applies when the timer expires, without waiting
+     * for room with block policy, and rejections are notified (see StreamIf::onRejected())
+     */
+    TimerId dispatchAfter(std::chrono::nanoseconds delay, std::shared_ptr<StreamIf> st, int priority = 0) {
+        return dispatchAt(std::chrono::steady_clock::now() + delay, std::move(st), priority);
+    }
+
+    /**
+     * Adds work to the queue at a time point
+     *
+     * @param at dispatch time (rounded up to timer resolution, see Settings::timerResolution)
+     * @param st stream to process
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @return timer identifier. Overload policy applies when the timer expires, without waiting
+     * for room with block policy, and rejections are notified (see StreamIf::onRejected())
+     */
+    TimerId dispatchAt(std::chrono::steady_clock::time_point at, std::shared_ptr<StreamIf> st, int priority = 0) {
+        return add_timer(Task{std::move(st), 0, false, priority_class(priority)}, at, std::chrono::nanoseconds(0), nullptr);
+    }
+
+    /**
+     * Adds work to the queue periodically, until cancelled
+     *
+     * @param period dispatch period (first dispatch after one period). Processing of consecutive
+     * periods may overlap when it lasts longer than the period
+     * @param st stream to process (the same one every period)
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @return timer identifier
+     */
+    TimerId dispatchEvery(std::chrono::nanoseconds period, std::shared_ptr<StreamIf> st, int priority = 0) {
+        return add_timer(Task{std::move(st), 0, false, priority_class(priority)}, std::chrono::steady_clock::now() + period, period, nullptr);
+    }
+
+    /**
+     * Adds a callable to the queue after a delay
+     *
+     * @param delay time until dispatch (rounded up to timer resolution, see Settings::timerResolution)
+     * @param f move-only callable with no arguments
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @return timer identifier
+     */
+    template <typename F, typename = typename std::enable_if<IsTaskCallable<F>::value>::type>
+    TimerId dispatchAfter(std::chrono::nanoseconds delay, F &&f, int priority = 0) {
+        return dispatchAt(std::chrono::steady_clock::now() + delay, std::forward<F>(f), priority);
+    }
+
+    /**
+     * Adds a callable to the queue at a time point
+     *
+     * @param at dispatch time (rounded up to timer resolution, see Settings::timerResolution)
+     * @param f move-only callable with no arguments
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @return timer identifier
+     */
+    template <typename F, typename = typename std::enable_if<IsTaskCallable<F>::value>::type>
+    TimerId dispatchAt(std::chrono::steady_clock::time_point at, F &&f, int priority = 0) {
+        return add_timer(Task{nullptr, 0, false, priority_class(priority), Callable(std::forward<F>(f))}, at, std::chrono::nanoseconds(0), nullptr);
+    }
+
+    /**
+     * Adds a callable to the queue periodically, until cancelled
+     *
+     * @param period dispatch period (first dispatch after one period). Runs of consecutive periods
+     * may overlap when they last longer than the period
+     * @param f callable with no arguments (shared by every period)
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @return timer identifier
+     */
+    template <typename F, typename = typename std::enable_if<IsTaskCallable<F>::value>::type>
+    TimerId dispatchEvery(std::chrono::nanoseconds period, F &&f, int priority = 0) {
+        return add_timer(Task{nullptr, 0, false, priority_class(priority)}, std::chrono::steady_clock::now() + period, period,
+                         std::make_shared<Callable>(std::forward<F>(f)));
+    }
+
+    /**
+     * Cancels delayed or periodic work
+     *
+     * @param id timer identifier
+     *
+     * @return false if the timer is unknown, already expired (one shot) or cancelled
+     */
+    bool cancel(TimerId id);
+
+    /**
+     * Awaitable which resumes the awaiting coroutine on a consumer thread (C++20 coroutines)
+     *
+     * @see schedule()
+     */
+    class Schedule
+    {
+    public:
+        Schedule(QueueDispatcher &dispatcher, int priority) : dispatcher_(dispatcher), priority_(priority) {}
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        // Handle type is a template parameter to keep this header C++17:
+        template <typename Handle>
+        void await_suspend(Handle handle) {
+            dispatcher_.resume(handle, priority_);
+        }
+
+        void await_resume() const noexcept {}
+
+    private:
+        QueueDispatcher &dispatcher_;
+        int priority_;
+    };
+
+    /**
+     * Reschedules the current coroutine on a consumer thread: 'co_await dispatcher.schedule();'
+     *
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @see Coroutine.hpp for coroutine task type and completion awaitable
+     */
+    Schedule schedule(int priority = 0) {
+        return Schedule(*this, priority);
+    }
+
+    /**
+     * Resumes a suspended coroutine on a consumer thread (C++20 coroutines)
+     *
+     * Resumptions are never discarded, as the coroutine frame would be leaked: they take room
+     * without admission (overload policy does not apply), drop-oldest policy resumes an evicted
+     * one on the producer thread, and the destructor resumes the pending ones on its own thread.
+     *
+     * @param handle coroutine handle (any type with resume())
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     */
+    template <typename Handle>
+    void resume(Handle handle, int priority = 0) {
+        Task task{nullptr, 0, false, priority_class(priority), Callable([handle]() mutable { handle.resume(); })};
+        task.resumption = true;
+        submit(std::move(task));
+    }
+
+    /**
+     * Adds a batch of work to the queue with a single lock acquisition and a wakeup sized to the batch
+     *
+     * @param streams streams to enqueue. They are moved into the queue and the vector is left empty
+     * (capacity is kept, so the caller may reuse it without new allocations)
+     * @param priority priority class (0 is the highest one, see Settings::priorityWeights)
+     *
+     * @return number of streams admitted (overload policy applies to each one when capacity is reached,
+     * and with block policy the ones admitted so far are enqueued before waiting for room)
+     */
+    size_t dispatchBatch(std::vector<std::shared_ptr<StreamIf>> &streams, int priority = 0);
 
     // Deleted operations
     QueueDispatcher(const QueueDispatcher& rhs) = delete;
@@ -100,14 +510,31 @@ public:
         return busy_threads_.load();
     }
 
-    /** Current available threads */
+    /** Number of threads busy with tasks of a priority class */
+    int getBusyThreads(int priority) const;
+
+    /** Current available threads (concurrency cap for virtual queues) */
     int getThreads() const {
-        return threads_.size();
+        return num_threads_.load();
     }
 
     /** Queue size */
-    int getSize() const {
-        return q_.size();
+    int getSize() const;
+
+    /** Queue size for a priority class */
+    int getSize(int priority) const;
+
+    /** Number of priority classes */
+    int getPriorityClasses() const {
+        return weights_.size();
+    }
+
+    /** Number of pending timers (delayed or periodic work) */
+    size_t getTimers() const;
+
+    /** Adaptive in-flight limit (zero when adaptive limiter is disabled) */
+    size_t getLimit() const {
+        return limiter_ ? limiter_->limit():0;
     }
 
     /** Queue name */
@@ -115,18 +542,231 @@ public:
         return name_;
     }
 
+    /** Shared executor of a virtual queue (empty when the queue owns its threads) */
+    const std::shared_ptr<Executor> &getExecutor() const {
+        return executor_;
+    }
+
+    /**
+     * Metrics snapshot (counters and histograms are empty unless Settings::metrics is enabled).
+     * Utilization is measured since the previous snapshot
+     */
+    MetricsSnapshot getMetrics();
+
+    /** Metrics snapshot in prometheus text exposition format (labeled with queue name) */
+    std::string getPrometheusMetrics() {
+        return getMetrics().asPrometheus(name_);
+    }
+
+    /**
+     * Flight recorder events as Chrome trace JSON, for chrome://tracing or ui.perfetto.dev
+     * (empty unless Settings::traceSampling is configured)
+     *
+     * @param window time window before now (zero: every event kept)
+     */
+    std::string getTrace(std::chrono::nanoseconds window = std::chrono::seconds(10)) const {
+        return recorder_ ? recorder_->asChromeTrace(window):std::string();
+    }
+
+    /**
+     * Writes flight recorder events as Chrome trace JSON into a file
+     *
+     * @param path output file (overwritten)
+     * @param window time window before now (zero: every event kept)
+     *
+     * @return false if flight recorder is disabled or the file could not be written
+     */
+    bool dumpTrace(const std::string &path, std::chrono::nanoseconds window = std::chrono::seconds(10)) const {
+        return recorder_ && recorder_->dump(path, window);
+    }
+
+    /**
+     * Writes flight recorder events as Chrome trace JSON into a file whenever a signal is received
+     *
+     * @param signum signal number (i.e. SIGUSR2). Any previous handler of the signal is replaced
+     * @param path output file (overwritten on every signal)
+     * @param window time window before the signal (zero: every event kept)
+     *
+     * @return false if flight recorder is disabled or signal watching is not available (see FlightRecorder::dumpOnSignal())
+     */
+    bool dumpTraceOnSignal(int signum, const std::string &path, std::chrono::nanoseconds window = std::chrono::seconds(10)) {
+        return recorder_ && recorder_->dumpOnSignal(signum, path, window);
+    }
+
 private:
+    friend class Executor;
+    friend class TimerService;
+
+    // Queue element
+    struct Task {
+        std::shared_ptr<StreamIf> stream;
+        std::uint64_t key = 0;
+        bool keyed = false;
+        unsigned priority = 0;
+        Callable call; // used instead of stream
+        std::chrono::steady_clock::time_point admitted; // metrics enabled
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        bool traced = false; // sampled by flight recorder
+        std::chrono::steady_clock::time_point dequeued; // traced tasks
+        bool resumption = false; // coroutine resumption: never discarded (see resume())
+    };
+
+    // Weighted round-robin position of a consumer between priority classes
+    struct ClassCursor {
+        size_t current = 0;
+        unsigned credit = 0;
+    };
+
     std::string name_;
     std::mutex lock_;
-    std::vector<std::thread> threads_;
+    std::vector<Fifo<Task>> q_; // one FIFO per priority class
+    std::condition_variable cv_;
+    std::atomic<bool> quit_{false}; // also read by lock-free consumers
     std::atomic<int> busy_threads_{0};
     size_t max_threads_;
-    std::queue<std::shared_ptr<StreamIf>> q_;
-    std::condition_variable cv_;
-    bool quit_ = false;
+    size_t batch_size_;
+
+    // Consumers pool (one slot per maximum thread, protected by pool_lock_):
+    std::mutex pool_lock_;
+    std::vector<std::thread> threads_;
+    std::vector<bool> alive_;
+    std::atomic<size_t> num_threads_{0};
+    size_t initial_threads_;
+    int grow_queue_depth_;
+    double grow_utilization_;
+    std::chrono::milliseconds idle_timeout_;
+    std::chrono::milliseconds resize_hysteresis_;
+    std::chrono::steady_clock::time_point last_resize_;
+
+    // Priority classes:
+    std::vector<unsigned> weights_;
+    bool strict_priority_;
+    std::unique_ptr<std::atomic<int>[]> class_busy_;
+    std::unique_ptr<std::atomic<int>[]> class_pending_; // locked backend
+
+    // Lock-free backend (one ring per priority class):
+    std::vector<std::unique_ptr<MpmcRing<Task>>> rings_;
+
+    // Work-stealing backend (one local deque per consumer slot, up to max threads, or per NUMA node, and priority class):
+    struct alignas(CacheLineSize) Worker {
+        std::mutex lock;
+        std::vector<Fifo<Task>> tasks;
+        std::unique_ptr<std::atomic<int>[]> pending; // per class (written under lock, read without it)
+        std::atomic<int> total{0};
+
+        void count(unsigned c, int delta) {
+            pending[c].store(pending[c].load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+            total.store(total.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+    };
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::unique_ptr<std::atomic<bool>[]> live_; // consumer slots with a running thread (work-stealing backend)
+    std::atomic<int> pending_{0}; // locked backend
+
+    // Placement:
+    std::vector<int> cpus_;
+    bool numa_ = false;
+    std::vector<std::vector<int>> node_cpus_; // NUMA backend
+    std::vector<int> cpu_node_; // -1 for CPUs of nodes left out
+
+    Sleepers sleepers_; // consumers parked on cv_
+    unsigned spin_iterations_;
+
+    // Admission control (admitted tasks still not dequeued, including the ones waiting in key lanes):
+    size_t capacity_;
+    OverloadPolicy overload_policy_;
+    std::chrono::milliseconds block_timeout_;
+    std::atomic<size_t> admitted_{0};
+    std::mutex room_lock_;
+    std::condition_variable room_cv_;
+    std::atomic<int> blocked_{0}; // producers waiting for room
+
+    // Metrics (one slot per maximum thread, written only by its consumer):
+    std::unique_ptr<ConsumerMetrics[]> metrics_;
+
+    // Admission counters, sharded by producer thread (summed on snapshot):
+    static constexpr size_t ProducerShards = 16;
+    struct alignas(CacheLineSize) ProducerCounters {
+        std::atomic<std::uint64_t> enqueued{0};
+        std::atomic<std::uint64_t> rejected{0};
+    };
+    std::unique_ptr<ProducerCounters[]> producer_counters_;
+    std::atomic<std::uint64_t> expired_{0}; // always counted
+    std::mutex metrics_lock_;
+    std::chrono::steady_clock::time_point metrics_since_; // utilization window
+    std::uint64_t metrics_busy_ = 0;
+
+    std::unique_ptr<AdaptiveLimiter> limiter_;
+    std::unique_ptr<FlightRecorder> recorder_;
+
+    // Timers (own service, or the executor one for virtual queues):
+    std::unique_ptr<TimerService> own_timers_;
+    TimerService *timers_;
+    size_t pending_timers_ = 0; // protected by the timer service
+    size_t due_batch_ = 0; // batch of due tasks being collected by the timer thread (one based, zero: none)
+
+    // Virtual queue (executor turns; consumer slots are executor worker indexes):
+    struct Turn {
+        ClassCursor cursor;
+        std::vector<Task> batch;
+        std::vector<std::shared_ptr<StreamIf>> streams;
+    };
+    std::shared_ptr<Executor> executor_;
+    Executor::Member *member_ = nullptr;
+    unsigned weight_ = 1;
+    std::vector<Turn> turns_; // one per executor worker
+    size_t consumer_slots_; // metrics slots
+
+    // Key-affine lanes: tasks waiting behind the in-flight one for each key (lanes are recycled)
+    static constexpr size_t KeyShards = 64;
+    struct alignas(CacheLineSize) KeyShard {
+        std::mutex lock;
+        KeyLanes<Task> lanes;
+    };
+    std::unique_ptr<KeyShard[]> key_shards_;
 
-    void dispatch_thread_handler(void);
-    void create_thread();
+    void dispatch_thread_handler(size_t index);
+    void run(size_t index);
+    size_t pop_batch(ClassCursor &cursor, std::vector<Task> &batch);
+    void notify_consumers(size_t count, size_t sleepers);
+    void worker_thread_handler(size_t index);
+    void process(Task &task);
+    bool discard_expired(Task &task);
+    void process(std::vector<Task> &batch, std::vector<std::shared_ptr<StreamIf>> &streams);
+    template <typename Ready> int pick_class(ClassCursor &cursor, Ready ready) const;
+    size_t try_pop(size_t index, ClassCursor &cursor, std::vector<Task> &batch);
+    bool steal(size_t index, ClassCursor &cursor, Task &task);
+    bool has_pending() const;
+    bool spin() const;
+    void wake_consumers(size_t count = 1);
+    void push_ring(Task &&task);
+    void enqueue(Task &&task);
+    void enqueue(std::vector<Task> &tasks);
+    void push_batch(std::vector<Task> &tasks, bool timer = false);
+    void reject_due(Task &task);
+    TimerId add_timer(Task &&task, std::chrono::steady_clock::time_point at, std::chrono::nanoseconds period, std::shared_ptr<Callable> periodic);
+    bool submit(Task &&task);
+    ProducerCounters &producer_counters();
+    bool admit(Task &task, bool timer = false);
+    bool overload(Task &task, bool timer);
+    bool reserve_room();
+    void release_room(size_t count = 1);
+    bool evict_oldest(Task &task);
+    bool drain_for_room();
+    void release_key(std::uint64_t key);
+    KeyShard &key_shard(std::uint64_t key);
+    unsigned priority_class(int priority) const;
+    bool busy_consumers() const;
+    ConsumerMetrics *consumer_metrics() const;
+    void account(ConsumerMetrics *metrics, const Task &task, std::chrono::steady_clock::time_point begin, std::uint64_t lapse, size_t inFlight);
+    void on_dequeue(std::vector<Task> &batch);
+    void trace(const Task &task, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+    void grow(size_t incoming = 1);
+    bool retire(size_t index);
+    void start_thread(size_t index);
+    void pin_thread(size_t index);
+    size_t worker_queue(size_t index) const;
+    size_t local_queue();
 };
 
 }
@@ -0,0 +1,184 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <chrono>
+#include <vector>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/**
+ * Queue backend used to store pending tasks
+ */
+enum class Backend {
+    Locked,  /**< unbounded FIFO protected by a mutex (default) */
+    LockFree, /**< bounded lock-free MPMC ring buffer (producers wait for room when full) */
+    WorkStealing, /**< per-consumer local deques; idle consumers steal from their peers */
+    Numa /**< per-NUMA node deques: consumers are placed on nodes, producers enqueue to their local node and idle nodes steal from remote ones */
+};
+
+/**
+ * Admission policy when queue capacity is reached
+ */
+enum class OverloadPolicy {
+    Reject,     /**< new task is discarded (tryDispatch() returns false) */
+    Block,      /**< producer waits for room up to a timeout, then new task is discarded. Consumers of the queue
+                     dispatching to it do not wait: they run pending tasks until there is room, and new task is
+                     discarded when none is left */
+    DropOldest, /**< oldest pending task is discarded (StreamIf::onRejected()) to make room */
+    Callback    /**< new task is discarded and notified (StreamIf::onRejected()) */
+};
+
+/**
+ * Queue dispatcher configuration
+ *
+ * @see ert::queuedispatcher::QueueDispatcher
+ */
+struct Settings {
+    /**
+     * Number of initial consumer threads. Must be positive number (wrong input will configure 1).
+     * Virtual queues own no threads (see Executor), and this is the initial concurrency cap instead
+     */
+    int threads = 1;
+
+    /**
+     * Maximum number of consumer threads. By default, it is equal to initial threads (freeze consumers pool size).
+     * For virtual queues, maximum number of executor threads serving the queue at the same time (concurrency cap)
+     */
+    int maxThreads = -1;
+
+    /** Queue backend (virtual queues always use the locked one) */
+    Backend backend = Backend::Locked;
+
+    /**
+     * Maximum number of pending tasks (zero: unbounded). Overload policy applies when reached.
+     * Lock-free backend is always bounded: its ring capacity is this value rounded up to power
+     * of two (1024 when unbounded, and then producers wait for room when the ring is full, while
+     * due timers are rejected)
+     */
+    size_t capacity = 0;
+
+    /** Action taken when a task is dispatched and capacity is reached */
+    OverloadPolicy overloadPolicy = OverloadPolicy::Reject;
+
+    /** Maximum time a producer waits for room with block policy (zero: wait forever) */
+    std::chrono::milliseconds blockTimeout{0};
+
+    /** Maximum number of tasks drained by a consumer per wakeup (batch consumption mode when greater than 1) */
+    size_t batchSize = 1;
+
+    /**
+     * Weights of priority classes, highest priority first (empty: single class). Consumers pick
+     * classes in weighted round-robin (a class is picked up to its weight times in a row) unless
+     * strict priority is configured
+     */
+    std::vector<unsigned> priorityWeights;
+
+    /** Consumers always pick the highest priority class with pending tasks */
+    bool strictPriority = false;
+
+    /**
+     * Iterations an idle consumer polls for new tasks (pausing the CPU, and yielding for the second half)
+     * before parking on a condition variable (zero: park at once). Latency-critical queues may trade CPU
+     * for wakeup latency, as short bursts are then picked up without the futex sleep and wake
+     */
+    unsigned spinIterations = 0;
+
+    /**
+     * Share of executor turns of a virtual queue when several ones are backlogged: every turn drains up to
+     * weight times batch size tasks (see Executor). Ignored by queues owning their threads
+     */
+    unsigned weight = 1;
+
+    /** Minimum number of pending tasks (including the one being dispatched) to grow the pool */
+    int growQueueDepth = 1;
+
+    /** Minimum ratio of busy threads (0..1] to grow the pool */
+    double growUtilization = 1.0;
+
+    /** Idle time after which a consumer thread over the initial number retires (zero: pool never shrinks) */
+    std::chrono::milliseconds idleTimeout{0};
+
+    /** Minimum time between consecutive pool size changes (grow or shrink), to prevent threads churn */
+    std::chrono::milliseconds resizeHysteresis{0};
+
+    /**
+     * CPUs where consumer threads are pinned, one CPU per consumer in a round-robin fashion (empty: no pinning).
+     * With NUMA backend, consumers are pinned to the CPUs of their node (restricted to these ones when given, so
+     * nodes with none of them get no consumers)
+     */
+    std::vector<int> cpus;
+
+    /**
+     * Queue wait target of the adaptive concurrency limiter (zero: disabled). The limiter adapts an
+     * in-flight tasks limit from measured queue wait and service times, and advises consumers to shed
+     * tasks over it (see ProcessContext::shed)
+     */
+    std::chrono::microseconds latencyTarget{0};
+
+    /** Lowest in-flight limit of the adaptive concurrency limiter */
+    size_t minLimit = 1;
+
+    /**
+     * Tick of the timing wheel behind delayed and periodic dispatch (see QueueDispatcher::dispatchAfter()).
+     * Virtual queues use the one of their executor
+     */
+    std::chrono::microseconds timerResolution{1000};
+
+    /**
+     * Ratio (0..1] of tasks recorded by the flight recorder, together with pool resize events (zero: disabled).
+     * See QueueDispatcher::getTrace()
+     */
+    double traceSampling = 0;
+
+    /** Events kept by the flight recorder per consumer thread (older ones are overwritten) */
+    size_t traceCapacity = 4096;
+
+    /** Record queue wait and service time histograms, and tasks counters (see QueueDispatcher::getMetrics()) */
+    bool metrics = false;
+};
+
+}
+}
+
@@ -39,11 +39,30 @@ SOFTWARE.
 
 #pragma once
 
+#include <cstddef>
+#include <memory>
+#include <vector>
+
 namespace ert
 {
 namespace queuedispatcher
 {
 
+/**
+ * Consumer view of the queue state when a task is processed
+ *
+ * @see ert::queuedispatcher::StreamIf::processWithContext()
+ */
+struct ProcessContext {
+    bool busyConsumers = false;       /**< potential congestion situation (see StreamIf::process()) */
+    int queueSize = 0;                /**< pending tasks */
+    int priority = 0;                 /**< priority class of the task */
+    unsigned long long queueWait = 0; /**< nanoseconds since dispatch (zero unless metrics or adaptive limiter are enabled) */
+    size_t inFlight = 0;              /**< tasks pending or being processed (adaptive limiter enabled) */
+    size_t limit = 0;                 /**< adaptive in-flight limit (zero: adaptive limiter disabled) */
+    bool shed = false;                /**< in-flight tasks exceed the adaptive limit: discarding the task keeps the latency target */
+};
+
 /**
  * Stream class interface to process queue dispatcher tasks
  *
@@ -66,12 +85,53 @@ public:
      */
     virtual void process(bool busyConsumers, int queueSize) = 0;
 
+    /**
+     * Consumer gets job from queue, with the whole queue state. Default implementation calls
+     * process() with the simple congestion indicators. Streams overriding this one still have
+     * to implement process(), which is not called then.
+     *
+     * @param context Queue state (i.e. adaptive limiter shedding advice, see Settings::latencyTarget)
+     */
+    virtual void processWithContext(const ProcessContext &context) {
+        process(context.busyConsumers, context.queueSize);
+    }
+
     /**
      * Queue control indicates the last process duration
      *
      * @param nanoseconds
      */
     virtual void processLapse(unsigned long long nanoseconds) {;}
+
+    /**
+     * Queue control discards this stream due to overload (see Settings::overloadPolicy):
+     * the stream was the oldest pending one with drop-oldest policy, or a new one with
+     * callback policy, or a due timer with any policy (timers never wait for room).
+     */
+    virtual void onRejected() {;}
+
+    /**
+     * Queue control discards this stream because its deadline passed before it was dequeued
+     * (see QueueDispatcher::dispatch() with deadline). Called instead of process(), so it
+     * should be cheap (i.e. just answer a timeout to the client).
+     */
+    virtual void onExpired() {;}
+
+    /**
+     * Consumer gets a batch of jobs from queue (batch consumption mode, see Settings::batchSize).
+     * This is called over the first stream in the batch. When it is not handled, each stream is
+     * processed individually with process() and processLapse(). When it is handled, every stream
+     * in the batch receives processLapse() with the batch duration divided evenly.
+     *
+     * @param batch Streams drained from the queue in a single consumer wakeup (this is the first one)
+     * @param busyConsumers Indicates potential congestion situation (simple congestion control may be context ignore)
+     * @param queueSize Indicates queue size (useful to improve congestion control algorithms when congestion is detected)
+     *
+     * @return true when the batch has been processed, false to fall back to individual processing (default)
+     */
+    virtual bool processBatch(std::vector<std::shared_ptr<StreamIf>> &batch, bool busyConsumers, int queueSize) {
+        return false;
+    }
 };
 
 }
@@ -0,0 +1,154 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include <ert/queuedispatcher/MpmcRing.hpp>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/**
+ * Pool of recycled stream objects
+ *
+ * Streams are created with std::allocate_shared over a recycling allocator, so
+ * the single block holding the object and its reference counters returns to
+ * the pool when the dispatcher releases the last reference (after process() and
+ * processLapse()), and is reused by the next make() call. A warmed-up pool does
+ * no heap allocation per task. Free blocks are kept in a lock-free ring, so
+ * producers and consumers threads may create and release streams concurrently.
+ *
+ * Blocks exceeding pool capacity are returned to the heap. The pool state is
+ * shared with the allocator copies, so streams may outlive the pool object.
+ *
+ * @see ert::queuedispatcher::StreamIf
+ */
+template <typename T>
+class StreamPool
+{
+    struct State {
+        MpmcRing<void*> free;
+        std::atomic<size_t> blockSize{0}; // learnt from first allocation (allocate_shared always requests the same)
+
+        explicit State(size_t capacity) : free(capacity) {}
+        ~State() {
+            void *block;
+            while (free.tryPop(block)) ::operator delete(block);
+        }
+
+        bool poolable(size_t size) {
+            size_t current = blockSize.load(std::memory_order_relaxed);
+            if (current == 0 && blockSize.compare_exchange_strong(current, size)) return true;
+            return current == size;
+        }
+
+        void *acquire(size_t size) {
+            void *block;
+            if (poolable(size) && free.tryPop(block)) return block;
+            return ::operator new(size);
+        }
+
+        void release(void *block, size_t size) {
+            if (poolable(size) && free.tryPush(std::move(block))) return;
+            ::operator delete(block);
+        }
+    };
+
+public:
+    /** Allocator recycling blocks through the pool state */
+    template <typename U>
+    struct Allocator {
+        using value_type = U;
+        template <typename V> struct rebind {
+            using other = Allocator<V>;
+        };
+
+        std::shared_ptr<State> state;
+
+        explicit Allocator(std::shared_ptr<State> s) : state(std::move(s)) {}
+        template <typename V> Allocator(const Allocator<V> &other) : state(other.state) {}
+
+        U *allocate(size_t n) {
+            return static_cast<U*>(state->acquire(n * sizeof(U)));
+        }
+
+        void deallocate(U *p, size_t n) {
+            state->release(p, n * sizeof(U));
+        }
+
+        template <typename V> bool operator==(const Allocator<V> &other) const {
+            return state == other.state;
+        }
+        template <typename V> bool operator!=(const Allocator<V> &other) const {
+            return state != other.state;
+        }
+    };
+
+    /** Constructor
+     *
+     * @param capacity maximum number of idle blocks kept for reuse (rounded up to power of two)
+     */
+    explicit StreamPool(size_t capacity = 1024) : state_(std::make_shared<State>(capacity)) {}
+
+    /** Creates a stream reusing an idle block when available */
+    template <typename... Args>
+    std::shared_ptr<T> make(Args&&... args) {
+        return std::allocate_shared<T>(Allocator<T>(state_), std::forward<Args>(args)...);
+    }
+
+    /** Number of idle blocks ready to be reused */
+    size_t getIdle() const {
+        return state_->free.size();
+    }
+
+private:
+    std::shared_ptr<State> state_;
+};
+
+}
+}
+
@@ -0,0 +1,142 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <string>
+#include <condition_variable>
+#include <memory>
+#include <cstdint>
+#include <chrono>
+
+#include <ert/queuedispatcher/QueueDispatcher.hpp>
+#include <ert/queuedispatcher/TimingWheel.hpp>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/**
+ * Timer thread feeding due delayed and periodic work into queue dispatchers
+ *
+ * Every queue dispatcher owning its consumers owns a service, while virtual
+ * queues share the one of their executor, so the number of timer threads does
+ * not follow the number of queues. Timers of all queues live in one
+ * hierarchical timing wheel, and due tasks are fed to their queues in batches
+ * (one per queue). The thread is started on first use, and sleeps until the
+ * next occupied wheel slot (or cascade), or while there are no timers.
+ *
+ * @see ert::queuedispatcher::QueueDispatcher::dispatchAfter()
+ */
+class TimerService
+{
+public:
+    /** Constructor
+     *
+     * @param name owner name/identifier (queue or executor)
+     * @param resolution wheel tick
+     */
+    TimerService(std::string name, std::chrono::steady_clock::duration resolution);
+
+    /** Destructor. Pending timers are discarded */
+    ~TimerService();
+
+    // Deleted operations
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    /**
+     * Adds a timer of a queue
+     *
+     * @param queue queue fed with the task
+     * @param task task enqueued on expiry (a copy for periodic timers)
+     * @param at expiry time (rounded up to the resolution)
+     * @param period period (zero: one shot)
+     * @param periodic callable shared by every period (callable periodic timers)
+     *
+     * @return timer identifier
+     */
+    QueueDispatcher::TimerId add(QueueDispatcher *queue, QueueDispatcher::Task &&task, std::chrono::steady_clock::time_point at,
+                                 std::chrono::nanoseconds period, std::shared_ptr<Callable> periodic);
+
+    /**
+     * Cancels a pending timer of a queue
+     *
+     * @return false if the timer is unknown, already expired, cancelled or belongs to other queue
+     */
+    bool cancel(QueueDispatcher *queue, QueueDispatcher::TimerId id);
+
+    /** Number of pending timers of a queue */
+    size_t size(const QueueDispatcher *queue) const;
+
+    /** Cancels the timers of a queue, and waits for due tasks being fed (the queue may be destroyed then) */
+    void detach(QueueDispatcher *queue);
+
+private:
+    struct Timer {
+        QueueDispatcher *queue = nullptr;
+        QueueDispatcher::Task task;
+        std::uint64_t period = 0; // ticks (zero: one shot)
+        std::shared_ptr<Callable> periodic; // callable shared by every period
+    };
+
+    std::string name_;
+    std::chrono::steady_clock::duration resolution_;
+    std::chrono::steady_clock::time_point origin_;
+
+    // Wheel and per queue counters are protected by lock_:
+    mutable std::mutex lock_;
+    std::condition_variable cv_;
+    std::condition_variable fed_cv_;
+    TimingWheel<Timer> wheel_;
+    std::thread thread_;
+    bool quit_ = false;
+    bool feeding_ = false; // due tasks being fed (without the lock)
+    std::uint64_t wakeup_ = 0; // tick the thread sleeps until (zero: not sleeping on pending timers)
+
+    std::uint64_t ticks(std::chrono::steady_clock::duration duration) const;
+    void thread_handler();
+};
+
+}
+}
@@ -0,0 +1,295 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+/**
+ * Hierarchical timing wheel
+ *
+ * Four levels of 256 slots: level 0 slots are one tick wide, and every upper level
+ * slot spans a whole lower level, so 2^32 ticks are covered (timers beyond that wait
+ * on the last level and are rescheduled). Adding and cancelling timers is O(1), and
+ * every tick expires one level 0 slot, cascading one slot of the upper levels down
+ * every 256 ticks.
+ *
+ * Entries live in a slab (recycled, so a warmed-up wheel does not allocate) linked in
+ * per slot intrusive lists. Identifiers carry the slab index and a generation, so stale
+ * identifiers of released entries are not mistaken for new ones. Not thread safe.
+ */
+template <typename T>
+class TimingWheel
+{
+public:
+    /** Timer identifier (never zero) */
+    using Id = std::uint64_t;
+
+    /** Constructor
+     *
+     * @param tick current tick
+     */
+    explicit TimingWheel(std::uint64_t tick = 0) : current_(tick) {
+        for (auto &head: heads_) head = Nil;
+    }
+
+    /** Current tick */
+    std::uint64_t tick() const {
+        return current_;
+    }
+
+    /** Number of pending timers */
+    size_t size() const {
+        return size_;
+    }
+
+    /** No pending timers */
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    /**
+     * Next tick worth advancing to: the first occupied level 0 slot, or the next level 0
+     * wrap around, where upper levels cascade down (so far timers only cost a wakeup every
+     * 256 ticks). Advancing to an earlier tick expires nothing.
+     *
+     * @return next tick (current one plus one when empty)
+     */
+    std::uint64_t next() const {
+        std::uint64_t tick = current_ + 1;
+        if (size_ == 0) return tick;
+
+        for (; (tick & SlotMask) != 0; tick++) {
+            if (heads_[tick & SlotMask] != Nil) return tick;
+        }
+        return tick;
+    }
+
+    /**
+     * Adds a timer
+     *
+     * @param due tick when it expires (past ticks expire on next one)
+     * @param value timer data
+     *
+     * @return timer identifier
+     */
+    Id add(std::uint64_t due, T &&value) {
+        std::uint32_t index;
+        if (free_.empty()) {
+            index = entries_.size();
+            entries_.emplace_back();
+        }
+        else {
+            index = free_.back();
+            free_.pop_back();
+        }
+
+        Entry &entry = entries_[index];
+        entry.value = std::move(value);
+        entry.due = due;
+        entry.used = true;
+        link(index, current_ + 1);
+        size_++;
+
+        return (Id(entry.generation) << 32) | index;
+    }
+
+    /**
+     * Data of a pending timer
+     *
+     * @return nullptr if the timer is unknown, already expired or cancelled
+     */
+    T *get(Id id) {
+        std::uint32_t index = id & 0xFFFFFFFF;
+        if (index >= entries_.size()) return nullptr;
+
+        Entry &entry = entries_[index];
+        if (!entry.used || entry.generation != (id >> 32)) return nullptr;
+        return &entry.value;
+    }
+
+    /**
+     * Cancels a pending timer
+     *
+     * @return false if the timer is unknown, already expired or cancelled
+     */
+    bool cancel(Id id) {
+        if (!get(id)) return false;
+
+        std::uint32_t index = id & 0xFFFFFFFF;
+        unlink(index);
+        release(index);
+        return true;
+    }
+
+    /**
+     * Cancels every pending timer whose data matches (linear in the number of entries)
+     *
+     * @return number of timers cancelled
+     */
+    template <typename Match>
+    size_t cancelIf(Match &&match) {
+        size_t count = 0;
+        for (std::uint32_t index = 0; index < entries_.size(); index++) {
+            if (!entries_[index].used || !match(entries_[index].value)) continue;
+            unlink(index);
+            release(index);
+            count++;
+        }
+        return count;
+    }
+
+    /**
+     * Advances the wheel up to a tick, expiring due timers
+     *
+     * @param tick target tick (nothing is done when it is not ahead of current one, and an empty wheel just jumps to it)
+     * @param expire called with the data and due tick of every expired timer (it must not add or cancel
+     * timers). It returns the next due tick to reschedule the timer with the same identifier (periodic
+     * timers), or zero to release it
+     */
+    template <typename Expire>
+    void advance(std::uint64_t tick, Expire &&expire) {
+        while (current_ < tick) {
+            if (size_ == 0) { // nothing to expire: jump
+                current_ = tick;
+                break;
+            }
+            current_++;
+
+            // Upper levels cascade down when lower ones wrap around:
+            for (size_t level = 1; level < Levels; level++) {
+                if (((current_ >> (SlotBits * (level - 1))) & SlotMask) != 0) break;
+                size_t slot = level * Slots + ((current_ >> (SlotBits * level)) & SlotMask);
+                std::uint32_t index = heads_[slot];
+                heads_[slot] = Nil;
+                while (index != Nil) {
+                    std::uint32_t next = entries_[index].next;
+                    link(index, current_); // current slot is expired right after
+                    index = next;
+                }
+            }
+
+            size_t slot = current_ & SlotMask;
+            std::uint32_t index = heads_[slot];
+            heads_[slot] = Nil;
+            while (index != Nil) {
+                Entry &entry = entries_[index];
+                std::uint32_t next = entry.next;
+                std::uint64_t due = expire(entry.value, entry.due);
+                if (due == 0) {
+                    release(index);
+                }
+                else {
+                    entry.due = due;
+                    link(index, current_ + 1);
+                }
+                index = next;
+            }
+        }
+    }
+
+private:
+    static constexpr size_t Levels = 4;
+    static constexpr size_t SlotBits = 8;
+    static constexpr size_t Slots = size_t(1) << SlotBits;
+    static constexpr std::uint64_t SlotMask = Slots - 1;
+    static constexpr std::uint32_t Nil = 0xFFFFFFFF;
+
+    struct Entry {
+        T value;
+        std::uint64_t due = 0;
+        std::uint32_t prev = Nil;
+        std::uint32_t next = Nil;
+        std::uint32_t slot = Nil;
+        std::uint32_t generation = 1;
+        bool used = false;
+    };
+
+    std::vector<Entry> entries_;
+    std::vector<std::uint32_t> free_;
+    std::uint32_t heads_[Levels * Slots];
+    std::uint64_t current_;
+    size_t size_ = 0;
+
+    void link(std::uint32_t index, std::uint64_t earliest) {
+        Entry &entry = entries_[index];
+
+        // Level by distance to due tick (overdue ones expire as soon as possible, far ones wait on last level):
+        std::uint64_t due = (entry.due > earliest) ? entry.due:earliest;
+        std::uint64_t delta = due - current_;
+        size_t level = 0;
+        while (level + 1 < Levels && delta >= (std::uint64_t(1) << (SlotBits * (level + 1)))) level++;
+        if (level + 1 == Levels && delta >= (std::uint64_t(1) << (SlotBits * Levels))) due = current_ + (std::uint64_t(1) << (SlotBits * Levels)) - 1;
+
+        std::uint32_t slot = level * Slots + ((due >> (SlotBits * level)) & SlotMask);
+        entry.slot = slot;
+        entry.prev = Nil;
+        entry.next = heads_[slot];
+        if (entry.next != Nil) entries_[entry.next].prev = index;
+        heads_[slot] = index;
+    }
+
+    void unlink(std::uint32_t index) {
+        Entry &entry = entries_[index];
+        if (entry.prev != Nil) entries_[entry.prev].next = entry.next;
+        else heads_[entry.slot] = entry.next;
+        if (entry.next != Nil) entries_[entry.next].prev = entry.prev;
+    }
+
+    void release(std::uint32_t index) {
+        Entry &entry = entries_[index];
+        entry.value = T();
+        entry.used = false;
+        entry.generation++;
+        free_.push_back(index);
+        size_--;
+    }
+};
+
+}
+}
+
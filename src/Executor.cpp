@@ -0,0 +1,162 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+
+#include <ert/tracing/Logger.hpp>
+
+#include <ert/queuedispatcher/Executor.hpp>
+#include <ert/queuedispatcher/QueueDispatcher.hpp>
+#include <ert/queuedispatcher/TimerService.hpp>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+Executor::Executor(std::string name, int threads, std::chrono::microseconds timerResolution) :
+    name_{std::move(name)}, timers_(new TimerService(name_, timerResolution))
+{
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    LOGINFORMATIONAL(ert::tracing::Logger::informational(
+                         ert::tracing::Logger::asString("Creating executor '%s' with '%d' threads.", name_.c_str(), threads), ERT_FILE_LOCATION));
+
+    for (int i = 0; i < threads; i++)
+    {
+        threads_.emplace_back(&Executor::worker_thread_handler, this, i);
+    }
+}
+
+Executor::~Executor()
+{
+    LOGINFORMATIONAL(ert::tracing::Logger::informational(
+                         ert::tracing::Logger::asString("Destroying executor threads ..."), ERT_FILE_LOCATION));
+
+    std::unique_lock<std::mutex> lock(lock_);
+    quit_ = true;
+    lock.unlock();
+    cv_.notify_all();
+
+    for (auto &thread: threads_)
+    {
+        if (thread.joinable()) thread.join();
+    }
+}
+
+size_t Executor::getQueues() const
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    return members_.size();
+}
+
+Executor::Member *Executor::attach(QueueDispatcher *queue, size_t cap)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    members_.emplace_back(new Member{queue, std::max(size_t(1), std::min(cap, threads_.size()))});
+    return members_.back().get();
+}
+
+void Executor::detach(Member *member)
+{
+    std::unique_lock<std::mutex> lock(lock_);
+    member->detached = true;
+    ready_.erase(std::remove(ready_.begin(), ready_.end(), member), ready_.end());
+    member->queued = 0;
+
+    // Turns being served must complete, as they use the queue:
+    detach_cv_.wait(lock, [member] { return member->running == 0; });
+
+    members_.erase(std::find_if(members_.begin(), members_.end(), [member](const std::unique_ptr<Member> &m) {
+        return m.get() == member;
+    }));
+}
+
+void Executor::notify(Member *member)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    schedule(member);
+}
+
+void Executor::schedule(Member *member)
+{
+    // One turn per pending task, up to the concurrency cap (lock held). Queue producers
+    // update the pending counter before notifying, so no work is left without a turn:
+    if (member->detached) return;
+
+    size_t pending = std::max(0, member->queue->pending_.load());
+    size_t turns = std::min(member->cap - member->running, pending);
+    while (member->queued < turns)
+    {
+        ready_.push_back(member);
+        member->queued++;
+        cv_.notify_one();
+    }
+}
+
+void Executor::worker_thread_handler(size_t index)
+{
+    std::unique_lock<std::mutex> lock(lock_);
+
+    while (true)
+    {
+        cv_.wait(lock, [this] { return quit_ || !ready_.empty(); });
+        if (quit_) break;
+
+        Member *member = ready_.front();
+        ready_.pop_front();
+        member->queued--;
+        member->running++;
+
+        lock.unlock();
+        busy_threads_++;
+        member->queue->run(index);
+        busy_threads_--;
+        lock.lock();
+
+        // Back to the tail of the ready queue when work is left (round-robin between queues):
+        member->running--;
+        if (member->detached) detach_cv_.notify_all();
+        else schedule(member);
+    }
+}
+
+}
+}
+
@@ -0,0 +1,307 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+#ifdef SYSTEM_LINUX
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#include <ert/tracing/Logger.hpp>
+
+#include <ert/queuedispatcher/FlightRecorder.hpp>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+namespace
+{
+// Signal watchers: signal number (zero: free slot, negative: claimed) and pipe write end.
+// Plain lock-free atomics, as they are read from the signal handler:
+constexpr int MaxWatchers = 16;
+std::atomic<int> watch_signal[MaxWatchers];
+std::atomic<int> watch_pipe[MaxWatchers];
+
+#ifdef SYSTEM_LINUX
+void on_signal(int signum)
+{
+    // Only async-signal-safe calls: watchers are woken up through their pipes
+    int saved = errno;
+    for (int i = 0; i < MaxWatchers; i++)
+    {
+        if (watch_signal[i].load() != signum) continue;
+        char byte = 0;
+        ssize_t rc = ::write(watch_pipe[i].load(), &byte, 1);
+        (void)rc;
+    }
+    errno = saved;
+}
+#endif
+
+// Microseconds (trace time unit) from nanoseconds:
+std::string us(std::uint64_t ns)
+{
+    return ert::tracing::Logger::asString("%.3f", ns / 1e3);
+}
+
+std::string escape(const std::string &value)
+{
+    std::string out;
+    for (char c: value)
+    {
+        if (c == '"' || c == '\\') out += '\\';
+        if (c >= 0 && c < 0x20) continue;
+        out += c;
+    }
+    return out;
+}
+}
+
+FlightRecorder::FlightRecorder(std::string name, size_t consumers, size_t capacity, double sampling) :
+    name_{std::move(name)}, origin_(std::chrono::steady_clock::now()), consumers_(consumers)
+{
+    // Sampling ratio as a period (one of every period tasks):
+    period_ = (sampling > 0 && sampling < 1) ? std::llround(1 / sampling):1;
+
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    mask_ = size - 1;
+
+    rings_.reset(new Ring[consumers_ + 1]);
+    for (size_t i = 0; i <= consumers_; i++) rings_[i].slots.reset(new Slot[size]);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+#ifdef SYSTEM_LINUX
+    if (watcher_slot_ < 0) return;
+
+    // Closing the write end stops the watcher (slot is still claimed meanwhile, so it is not reused):
+    watch_signal[watcher_slot_] = -1;
+    ::close(watch_pipe[watcher_slot_].exchange(-1));
+    if (watcher_.joinable()) watcher_.join();
+    ::close(watcher_pipe_);
+    watch_signal[watcher_slot_] = 0;
+#endif
+}
+
+std::uint64_t FlightRecorder::since_origin(std::chrono::steady_clock::time_point time) const
+{
+    if (time <= origin_) return 0;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time - origin_).count();
+}
+
+void FlightRecorder::write(size_t ring, std::uint64_t enqueue, std::uint64_t dequeue, std::uint64_t start, std::uint64_t end, std::uint64_t info)
+{
+    Ring &r = rings_[ring];
+    std::uint64_t position = r.head.load(std::memory_order_relaxed);
+    Slot &slot = r.slots[position & mask_];
+
+    // Seqlock write: readers discard the slot unless sequence is the same before and after copying it
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.enqueue.store(enqueue, std::memory_order_relaxed);
+    slot.dequeue.store(dequeue, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.info.store(info, std::memory_order_relaxed);
+    slot.sequence.store(position + 1, std::memory_order_release);
+
+    r.head.store(position + 1, std::memory_order_release);
+}
+
+void FlightRecorder::record(size_t consumer, std::chrono::steady_clock::time_point enqueue, std::chrono::steady_clock::time_point dequeue,
+                            std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, size_t depth, unsigned priority)
+{
+    std::uint64_t info = std::uint64_t(Kind::Task) | (std::uint64_t(priority & 0xFFFFFF) << 8) | (std::uint64_t(std::min(depth, size_t(0xFFFFFFFF))) << 32);
+    write(consumer, since_origin(enqueue), since_origin(dequeue), since_origin(start), since_origin(end), info);
+}
+
+void FlightRecorder::record(Kind kind, size_t threads)
+{
+    std::uint64_t now = since_origin(std::chrono::steady_clock::now());
+    write(consumers_, now, now, now, now, std::uint64_t(kind) | (std::uint64_t(threads) << 32));
+}
+
+std::string FlightRecorder::asChromeTrace(std::chrono::nanoseconds window) const
+{
+    std::uint64_t now = since_origin(std::chrono::steady_clock::now());
+    std::uint64_t from = (window.count() > 0 && now > std::uint64_t(window.count())) ? now - window.count():0;
+
+    // Copy events out of the rings (skipping the ones overwritten meanwhile):
+    std::vector<Event> events;
+    for (size_t ring = 0; ring <= consumers_; ring++)
+    {
+        const Ring &r = rings_[ring];
+        std::uint64_t head = r.head.load(std::memory_order_acquire);
+        std::uint64_t first = (head > mask_ + 1) ? head - (mask_ + 1):0;
+
+        for (std::uint64_t position = first; position < head; position++)
+        {
+            const Slot &slot = r.slots[position & mask_];
+            std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence != position + 1) continue;
+
+            Event event{ring, slot.enqueue.load(std::memory_order_relaxed), slot.dequeue.load(std::memory_order_relaxed),
+                        slot.start.load(std::memory_order_relaxed), slot.end.load(std::memory_order_relaxed), slot.info.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != sequence) continue;
+
+            if (event.end >= from) events.push_back(event);
+        }
+    }
+
+    std::sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.start < b.start; });
+
+    // Process is the queue, thread 0 the pool, and thread i + 1 the consumer i:
+    std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"" + escape(name_) + "\"}},\n";
+    out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"pool\"}}";
+    for (size_t i = 0; i < consumers_; i++)
+    {
+        out += ert::tracing::Logger::asString(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"consumer %zu\"}}", i + 1, i);
+    }
+
+    std::uint64_t id = 0;
+    for (const auto &event: events)
+    {
+        Kind kind = Kind(event.info & 0xFF);
+        std::uint64_t value = event.info >> 32;
+
+        if (kind != Kind::Task)
+        {
+            out += ert::tracing::Logger::asString(",\n{\"name\":\"%s\",\"cat\":\"pool\",\"ph\":\"i\",\"s\":\"p\",\"pid\":1,\"tid\":0,\"ts\":%s,\"args\":{\"threads\":%llu}}",
+                                                  (kind == Kind::Grow) ? "grow":"shrink", us(event.start).c_str(), (unsigned long long)value);
+            out += ert::tracing::Logger::asString(",\n{\"name\":\"threads\",\"ph\":\"C\",\"pid\":1,\"ts\":%s,\"args\":{\"threads\":%llu}}",
+                                                  us(event.start).c_str(), (unsigned long long)value);
+            continue;
+        }
+
+        size_t tid = event.ring + 1;
+        unsigned priority = (event.info >> 8) & 0xFFFFFF;
+        std::uint64_t dequeue = std::max(event.enqueue, std::min(event.dequeue, event.start));
+        id++;
+
+        out += ert::tracing::Logger::asString(",\n{\"name\":\"queued\",\"cat\":\"queue\",\"ph\":\"b\",\"id\":%llu,\"pid\":1,\"tid\":%zu,\"ts\":%s}",
+                                              (unsigned long long)id, tid, us(event.enqueue).c_str());
+        out += ert::tracing::Logger::asString(",\n{\"name\":\"queued\",\"cat\":\"queue\",\"ph\":\"e\",\"id\":%llu,\"pid\":1,\"tid\":%zu,\"ts\":%s}",
+                                              (unsigned long long)id, tid, us(dequeue).c_str());
+        out += ert::tracing::Logger::asString(",\n{\"name\":\"process\",\"cat\":\"task\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%s,\"dur\":%s,"
+                                              "\"args\":{\"priority\":%u,\"depth\":%llu,\"queueWait\":%s,\"dequeueToStart\":%s}}",
+                                              tid, us(event.start).c_str(), us(event.end - event.start).c_str(), priority, (unsigned long long)value,
+                                              us(dequeue - event.enqueue).c_str(), us(event.start - dequeue).c_str());
+    }
+
+    out += "\n]}\n";
+    return out;
+}
+
+bool FlightRecorder::dump(const std::string &path, std::chrono::nanoseconds window) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file) return false;
+    file << asChromeTrace(window);
+    return bool(file);
+}
+
+bool FlightRecorder::dumpOnSignal(int signum, const std::string &path, std::chrono::nanoseconds window)
+{
+#ifdef SYSTEM_LINUX
+    if (watcher_slot_ >= 0 || signum <= 0) return false;
+
+    int fds[2];
+    if (::pipe2(fds, O_CLOEXEC) != 0) return false;
+    ::fcntl(fds[1], F_SETFL, O_NONBLOCK); // handler never blocks (signals received meanwhile are coalesced)
+
+    int slot = -1;
+    for (int i = 0; i < MaxWatchers && slot < 0; i++)
+    {
+        int expected = 0;
+        if (watch_signal[i].compare_exchange_strong(expected, -1)) slot = i;
+    }
+
+    struct sigaction action {};
+    action.sa_handler = on_signal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+
+    if (slot < 0 || ::sigaction(signum, &action, nullptr) != 0)
+    {
+        if (slot >= 0) watch_signal[slot] = 0;
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return false;
+    }
+
+    watcher_slot_ = slot;
+    watcher_pipe_ = fds[0];
+    watch_pipe[slot] = fds[1];
+    watch_signal[slot] = signum;
+
+    watcher_ = std::thread([this, path, window] {
+        char byte;
+        while (true)
+        {
+            ssize_t rc = ::read(watcher_pipe_, &byte, 1);
+            if (rc < 0 && errno == EINTR) continue;
+            if (rc <= 0) break; // write end closed
+
+            bool written = dump(path, window);
+            LOGINFORMATIONAL(ert::tracing::Logger::informational(ert::tracing::Logger::asString("Queue '%s' flight recorder %s '%s'",
+                             name_.c_str(), written ? "dumped to":"cannot write", path.c_str()), ERT_FILE_LOCATION));
+        }
+    });
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+}
+}
+
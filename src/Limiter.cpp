@@ -0,0 +1,94 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+
+#include <ert/queuedispatcher/Limiter.hpp>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+AdaptiveLimiter::AdaptiveLimiter(std::chrono::nanoseconds target, size_t initial, size_t minimum) :
+    target_(target.count()), minimum_((minimum > 0) ? minimum:1), limit_(std::max(initial, minimum_)),
+    since_(std::chrono::steady_clock::now())
+{
+}
+
+void AdaptiveLimiter::sample(unsigned long long queueWait, unsigned long long service, size_t inFlight)
+{
+    std::unique_lock<std::mutex> lock(lock_, std::try_to_lock);
+    if (!lock.owns_lock()) return;
+
+    samples_++;
+    wait_ += queueWait;
+    service_ += service;
+    peak_ = std::max(peak_, inFlight);
+
+    size_t limit = limit_.load(std::memory_order_relaxed);
+    if (samples_ < limit) return;
+
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - since_).count();
+    double wait = wait_ / samples_;
+
+    if (wait > target_)
+    {
+        // Little's law: in-flight tasks which are served within target at current throughput
+        double service = service_ / samples_;
+        double littles = (elapsed > 0) ? (samples_ / elapsed) * (target_ + service):0;
+        limit = std::max(minimum_, std::min(size_t(limit * Backoff), std::max(size_t(littles), size_t(limit * Backoff * Backoff))));
+    }
+    else if (peak_ * 2 >= limit)
+    {
+        limit++;
+    }
+    limit_.store(limit, std::memory_order_relaxed);
+
+    since_ = now;
+    samples_ = 0;
+    wait_ = 0;
+    service_ = 0;
+    peak_ = 0;
+}
+
+}
+}
+
@@ -0,0 +1,129 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <limits>
+
+#include <ert/tracing/Logger.hpp>
+
+#include <ert/queuedispatcher/Metrics.hpp>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+namespace
+{
+// Label values escape backslash, double quote and line feed (exposition format):
+std::string escape(const std::string &value)
+{
+    std::string out;
+    for (char c: value)
+    {
+        if (c == '\\') out += "\\\\";
+        else if (c == '"') out += "\\\"";
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+    return out;
+}
+
+void counter(std::string &out, const char *name, const char *help, const std::string &labels, double value)
+{
+    out += ert::tracing::Logger::asString("# HELP ert_queuedispatcher_%s %s\n# TYPE ert_queuedispatcher_%s counter\n", name, help, name);
+    out += ert::tracing::Logger::asString("ert_queuedispatcher_%s{%s} %.17g\n", name, labels.c_str(), value);
+}
+
+void gauge(std::string &out, const char *name, const char *help, const std::string &labels, double value)
+{
+    out += ert::tracing::Logger::asString("# HELP ert_queuedispatcher_%s %s\n# TYPE ert_queuedispatcher_%s gauge\n", name, help, name);
+    out += ert::tracing::Logger::asString("ert_queuedispatcher_%s{%s} %.17g\n", name, labels.c_str(), value);
+}
+
+void histogram(std::string &out, const char *name, const char *help, const std::string &labels, const LatencyHistogram::Snapshot &h)
+{
+    out += ert::tracing::Logger::asString("# HELP ert_queuedispatcher_%s %s\n# TYPE ert_queuedispatcher_%s histogram\n", name, help, name);
+
+    // Buckets are cumulative in prometheus:
+    std::uint64_t cumulative = 0;
+    for (size_t i = 0; i < LatencyHistogram::Buckets; i++)
+    {
+        cumulative += h.buckets[i];
+        if (i + 1 < LatencyHistogram::Buckets) out += ert::tracing::Logger::asString("ert_queuedispatcher_%s_bucket{%s,le=\"%.9g\"} %llu\n",
+                    name, labels.c_str(), LatencyHistogram::upperBound(i), (unsigned long long)cumulative);
+        else out += ert::tracing::Logger::asString("ert_queuedispatcher_%s_bucket{%s,le=\"+Inf\"} %llu\n",
+                        name, labels.c_str(), (unsigned long long)cumulative);
+    }
+    out += ert::tracing::Logger::asString("ert_queuedispatcher_%s_sum{%s} %.9f\n", name, labels.c_str(), h.sum / 1e9);
+    out += ert::tracing::Logger::asString("ert_queuedispatcher_%s_count{%s} %llu\n", name, labels.c_str(), (unsigned long long)h.count);
+}
+}
+
+double LatencyHistogram::upperBound(size_t i)
+{
+    if (i + 1 >= Buckets) return std::numeric_limits<double>::infinity();
+    return std::ldexp(1024.0, i) / 1e9;
+}
+
+std::string MetricsSnapshot::asPrometheus(const std::string &queue) const
+{
+    std::string out;
+    std::string labels = "queue=\"" + escape(queue) + "\"";
+
+    counter(out, "enqueued_total", "Tasks admitted into the queue.", labels, enqueued);
+    counter(out, "processed_total", "Tasks processed by consumers.", labels, processed);
+    counter(out, "rejected_total", "Tasks discarded by the overload policy.", labels, rejected);
+    counter(out, "expired_total", "Tasks discarded because their deadline passed before processing.", labels, expired);
+    counter(out, "busy_seconds_total", "Time spent by consumers processing tasks.", labels, busySeconds);
+    gauge(out, "depth", "Pending tasks.", labels, depth);
+    gauge(out, "peak_depth", "Highest number of pending tasks.", labels, peakDepth);
+    gauge(out, "threads", "Consumer threads.", labels, threads);
+    gauge(out, "busy_threads", "Consumer threads processing tasks.", labels, busyThreads);
+    if (limit > 0) gauge(out, "limit", "Adaptive in-flight tasks limit.", labels, limit);
+    gauge(out, "utilization", "Ratio of consumers time spent processing since previous scrape.", labels, utilization);
+    histogram(out, "queue_wait_seconds", "Time since dispatch until processing starts.", labels, queueWait);
+    histogram(out, "service_seconds", "Task processing time.", labels, service);
+
+    return out;
+}
+
+}
+}
+
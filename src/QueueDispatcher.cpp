@@ -37,32 +37,232 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <algorithm>
 #include <chrono>
+#include <fstream>
+
+#ifdef SYSTEM_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 #include <ert/tracing/Logger.hpp>
 
 #include <ert/queuedispatcher/QueueDispatcher.hpp>
+#include <ert/queuedispatcher/TimerService.hpp>
 
 namespace ert
 {
 namespace queuedispatcher
 {
 
+namespace
+{
+// Identifies the dispatcher and consumer slot owning the current thread:
+struct CurrentWorker {
+    const void *dispatcher;
+    size_t index;
+};
+thread_local CurrentWorker current_worker{nullptr, 0};
+
+// Parses kernel CPU lists (i.e. "0-3,8-11"):
+std::vector<int> parse_cpu_list(const std::string &list)
+{
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size())
+    {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        std::string range = list.substr(pos, end - pos);
+        size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = (dash == std::string::npos) ? first:std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+        }
+        catch (std::exception &e) {;} // empty or malformed range
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+// CPUs of every NUMA node (single node with every CPU when topology is not available):
+std::vector<std::vector<int>> numa_nodes()
+{
+    std::vector<std::vector<int>> nodes;
+#ifdef SYSTEM_LINUX
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string list;
+    if (std::getline(online, list))
+    {
+        for (int node: parse_cpu_list(list))
+        {
+            std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string cpus;
+            if (std::getline(cpulist, cpus) && !parse_cpu_list(cpus).empty()) nodes.push_back(parse_cpu_list(cpus));
+        }
+    }
+#endif
+    if (nodes.empty())
+    {
+        nodes.emplace_back();
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++) nodes[0].push_back(cpu);
+    }
+    return nodes;
+}
+}
 
 QueueDispatcher::QueueDispatcher(std::string name, int threads, int maxThreads) :
-    name_{std::move(name)}, threads_((threads > 0) ? threads:1), max_threads_(maxThreads)
+    QueueDispatcher(std::move(name), Settings{threads, maxThreads})
+{
+}
+
+QueueDispatcher::QueueDispatcher(std::string name, const Settings &settings) :
+    QueueDispatcher(std::move(name), nullptr, settings)
 {
-    threads = ((threads > 0) ? threads:1); // protection for bad input
-    max_threads_ = (maxThreads > threads) ? maxThreads:threads;
+}
+
+QueueDispatcher::QueueDispatcher(std::string name, std::shared_ptr<Executor> executor, const Settings &settings) :
+    name_{std::move(name)}, max_threads_(settings.maxThreads), batch_size_((settings.batchSize > 1) ? settings.batchSize:1),
+    initial_threads_((settings.threads > 0) ? settings.threads:1),
+    grow_queue_depth_(settings.growQueueDepth), grow_utilization_(settings.growUtilization),
+    idle_timeout_(settings.idleTimeout), resize_hysteresis_(settings.resizeHysteresis),
+    weights_(settings.priorityWeights), strict_priority_(settings.strictPriority),
+    capacity_(settings.capacity), overload_policy_(settings.overloadPolicy), block_timeout_(settings.blockTimeout),
+    cpus_(settings.cpus), numa_(!executor && settings.backend == Backend::Numa), spin_iterations_(settings.spinIterations),
+    executor_(std::move(executor))
+{
+    // Virtual queues share the timer thread of the executor:
+    if (executor_) timers_ = executor_->timers_.get();
+    else
+    {
+        own_timers_.reset(new TimerService(name_, settings.timerResolution));
+        timers_ = own_timers_.get();
+    }
+
+    int threads = ((settings.threads > 0) ? settings.threads:1); // protection for bad input
+    max_threads_ = (settings.maxThreads > threads) ? settings.maxThreads:threads;
+
+    // Virtual queue: thread counts are the concurrency cap (executor threads at most)
+    Backend backend = settings.backend;
+    if (executor_)
+    {
+        max_threads_ = std::min(max_threads_, size_t(executor_->getThreads()));
+        initial_threads_ = max_threads_;
+        threads = max_threads_;
+        weight_ = (settings.weight > 0) ? settings.weight:1;
+        backend = Backend::Locked;
+    }
+    consumer_slots_ = executor_ ? executor_->getThreads():max_threads_;
+
+    if (weights_.empty()) weights_.push_back(1);
+    for (auto &weight: weights_) if (weight == 0) weight = 1;
+    size_t classes = weights_.size();
+
+    class_busy_.reset(new std::atomic<int>[classes]);
+    class_pending_.reset(new std::atomic<int>[classes]);
+    for (size_t c = 0; c < classes; c++)
+    {
+        class_busy_[c] = 0;
+        class_pending_[c] = 0;
+    }
+
+    if (backend == Backend::LockFree) {
+        for (size_t c = 0; c < classes; c++) rings_.emplace_back(new MpmcRing<Task>(capacity_ ? capacity_:1024));
+    }
+    else if (backend == Backend::WorkStealing || numa_) {
+        if (numa_)
+        {
+            for (auto &cpus: numa_nodes())
+            {
+                // Placement restricted to configured CPUs, leaving out nodes with none of them:
+                std::vector<int> allowed;
+                for (int cpu: cpus) if (cpus_.empty() || std::find(cpus_.begin(), cpus_.end(), cpu) != cpus_.end()) allowed.push_back(cpu);
+                if (allowed.empty()) continue;
+
+                // Producers on any CPU of the node enqueue to it:
+                for (int cpu: cpus)
+                {
+                    if (cpu >= cpu_node_.size()) cpu_node_.resize(cpu + 1, -1);
+                    cpu_node_[cpu] = node_cpus_.size();
+                }
+                node_cpus_.push_back(std::move(allowed));
+            }
+
+            // Configured CPUs unknown to every node: consumers are pinned to them anyway (failure is reported there)
+            if (node_cpus_.empty()) node_cpus_.push_back(cpus_);
+        }
+        workers_.resize(numa_ ? node_cpus_.size():max_threads_);
+        if (!numa_)
+        {
+            live_.reset(new std::atomic<bool>[max_threads_]);
+            for (size_t i = 0; i < max_threads_; i++) live_[i] = false;
+        }
+        for (auto &worker: workers_)
+        {
+            worker.reset(new Worker);
+            worker->tasks.resize(classes);
+            worker->pending.reset(new std::atomic<int>[classes]);
+            for (size_t c = 0; c < classes; c++) worker->pending[c] = 0;
+        }
+    }
+    else {
+        q_.resize(classes);
+    }
+    key_shards_.reset(new KeyShard[KeyShards]);
+
+    if (settings.latencyTarget.count() > 0) limiter_.reset(new AdaptiveLimiter(settings.latencyTarget, max_threads_, settings.minLimit));
+
+    if (settings.metrics)
+    {
+        metrics_.reset(new ConsumerMetrics[consumer_slots_]);
+        producer_counters_.reset(new ProducerCounters[ProducerShards]);
+        metrics_since_ = std::chrono::steady_clock::now();
+    }
+
+    if (settings.traceSampling > 0) recorder_.reset(new FlightRecorder(name_, consumer_slots_, settings.traceCapacity, settings.traceSampling));
 
     LOGINFORMATIONAL(
         std::string msg = ert::tracing::Logger::asString("Creating dispatch queue '%s' with '%zu' ", name_.c_str(), threads);
-        msg += (max_threads_ == threads) ? "fixed threads.":ert::tracing::Logger::asString("threads and a maximum of '%zu'.", max_threads_);
+        if (executor_) msg = ert::tracing::Logger::asString("Creating virtual dispatch queue '%s' on executor '%s' with concurrency cap '%zu' and weight '%u'",
+                                                                name_.c_str(), executor_->getName().c_str(), max_threads_, weight_);
+        else msg += (max_threads_ == threads) ? "fixed threads":ert::tracing::Logger::asString("threads and a maximum of '%zu'", max_threads_);
+        if (!rings_.empty()) msg += ert::tracing::Logger::asString(" (lock-free ring capacity: '%zu')", rings_[0]->capacity());
+        if (numa_) msg += ert::tracing::Logger::asString(" (work-stealing between '%zu' NUMA nodes)", node_cpus_.size());
+        else if (!workers_.empty()) msg += " (work-stealing)";
+        if (!cpus_.empty()) msg += ert::tracing::Logger::asString(" (pinned to '%zu' CPUs)", cpus_.size());
+        if (batch_size_ > 1) msg += ert::tracing::Logger::asString(" (consumer batches up to '%zu')", batch_size_);
+        if (capacity_ > 0) msg += ert::tracing::Logger::asString(" (capacity: '%zu')", capacity_);
+        if (classes > 1) msg += ert::tracing::Logger::asString(" ('%zu' priority classes, %s)", classes, strict_priority_ ? "strict":"weighted");
+        if (idle_timeout_.count() > 0) msg += ert::tracing::Logger::asString(" (idle threads retire after '%lld' ms)", (long long)idle_timeout_.count());
+        if (spin_iterations_ > 0) msg += ert::tracing::Logger::asString(" (idle consumers spin '%u' iterations before parking)", spin_iterations_);
+        if (limiter_) msg += ert::tracing::Logger::asString(" (adaptive limiter with '%lld' us latency target)", (long long)settings.latencyTarget.count());
+        if (recorder_) msg += ert::tracing::Logger::asString(" (flight recorder sampling '%g')", settings.traceSampling);
+        if (metrics_) msg += " (metrics enabled)";
+        msg += ".";
         ert::tracing::Logger::informational(msg, ERT_FILE_LOCATION));
 
-    for (size_t i = 0; i < threads_.size(); i++)
+    if (executor_)
+    {
+        turns_.resize(consumer_slots_);
+        for (auto &turn: turns_)
+        {
+            turn.batch.reserve(batch_size_);
+            turn.streams.reserve(batch_size_);
+        }
+        num_threads_ = max_threads_;
+        member_ = executor_->attach(this, max_threads_);
+        return;
+    }
+
+    threads_.resize(max_threads_);
+    alive_.resize(max_threads_, false);
+
+    std::lock_guard<std::mutex> guard(pool_lock_);
+    for (size_t i = 0; i < initial_threads_; i++)
     {
-        threads_[i] = std::thread(&QueueDispatcher::dispatch_thread_handler, this);
+        start_thread(i);
     }
 }
 
@@ -71,88 +271,1152 @@ QueueDispatcher::~QueueDispatcher()
     LOGINFORMATIONAL(ert::tracing::Logger::informational(
                          ert::tracing::Logger::asString("Destroying dispatch threads ..."), ERT_FILE_LOCATION));
 
-    // Signal to dispatch threads that it's time to wrap up
+    // Timers are discarded (they stop first, as they feed the queue)
+    timers_->detach(this);
+    own_timers_.reset();
+
+    // Virtual queue leaves the executor once its turns in progress are completed (from then on,
+    // work enqueued meanwhile is not notified to it, as its membership is released):
+    if (member_)
+    {
+        executor_->detach(member_);
+        member_ = nullptr;
+    }
+
+    // Signal to dispatch threads that it's time to wrap up. Every backend behaves the same:
+    // consumers complete the tasks in hand and stop, and pending tasks are discarded
     std::unique_lock<std::mutex> lock(lock_);
     quit_ = true;
     lock.unlock();
     cv_.notify_all();
 
-    // Wait for threads to finish before we exit
-    for (size_t i = 0; i < threads_.size(); i++)
+    // Wait for threads to finish before we exit (pool is taken under its lock, as consumers
+    // could be growing it, and it cannot grow any more once quit is signaled):
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> guard(pool_lock_);
+        threads.swap(threads_);
+    }
+
+    for (size_t i = 0; i < threads.size(); i++)
     {
-        if (threads_[i].joinable())
+        if (threads[i].joinable())
         {
             LOGINFORMATIONAL(ert::tracing::Logger::informational(
                                  ert::tracing::Logger::asString("Joining thread %zu until completion", i), ERT_FILE_LOCATION));
-            threads_[i].join();
+            threads[i].join();
+        }
+    }
+
+    // Coroutine resumptions are not discarded with the rest of pending tasks, but run here so
+    // their frames are released (they may enqueue further resumptions, drained as well):
+    Task task;
+    while (evict_oldest(task))
+    {
+        if (task.resumption) task.call();
+        task = Task();
+    }
+}
+
+int QueueDispatcher::getSize() const
+{
+    size_t size = 0;
+    if (!rings_.empty())
+    {
+        for (size_t c = 0; c < weights_.size(); c++) size += rings_[c]->size();
+    }
+    else if (!workers_.empty())
+    {
+        for (auto &worker: workers_) size += worker->total.load(std::memory_order_relaxed);
+    }
+    else size = pending_.load();
+    return size;
+}
+
+int QueueDispatcher::getSize(int priority) const
+{
+    unsigned c = priority_class(priority);
+    if (!rings_.empty()) return rings_[c]->size();
+    if (workers_.empty()) return class_pending_[c].load();
+
+    int size = 0;
+    for (auto &worker: workers_) size += worker->pending[c].load(std::memory_order_relaxed);
+    return size;
+}
+
+int QueueDispatcher::getBusyThreads(int priority) const
+{
+    if (weights_.size() == 1) return busy_threads_.load();
+    return class_busy_[priority_class(priority)].load();
+}
+
+unsigned QueueDispatcher::priority_class(int priority) const
+{
+    // Out of range priorities are clamped to existing classes:
+    if (priority < 0) return 0;
+    return (priority < weights_.size()) ? priority:(weights_.size() - 1);
+}
+
+void QueueDispatcher::start_thread(size_t index)
+{
+    // Slot could belong to a retired thread (already out of its loop):
+    if (threads_[index].joinable()) threads_[index].join();
+
+    alive_[index] = true;
+    if (live_) live_[index] = true;
+    num_threads_++;
+
+    if (!rings_.empty() || !workers_.empty()) threads_[index] = std::thread(&QueueDispatcher::worker_thread_handler, this, index);
+    else threads_[index] = std::thread(&QueueDispatcher::dispatch_thread_handler, this, index);
+
+    pin_thread(index);
+}
+
+void QueueDispatcher::pin_thread(size_t index)
+{
+#ifdef SYSTEM_LINUX
+    std::vector<int> cpus;
+    if (numa_) cpus = node_cpus_[worker_queue(index)];
+    else if (!cpus_.empty()) cpus.push_back(cpus_[index % cpus_.size()]);
+    if (cpus.empty()) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu: cpus) if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+
+    int rc = pthread_setaffinity_np(threads_[index].native_handle(), sizeof(set), &set);
+    if (rc != 0)
+    {
+        LOGWARNING(ert::tracing::Logger::warning(ert::tracing::Logger::asString("Queue '%s' cannot pin thread %zu (error %d)", name_.c_str(), index, rc), ERT_FILE_LOCATION));
+    }
+#endif
+}
+
+size_t QueueDispatcher::worker_queue(size_t index) const
+{
+    // NUMA nodes are assigned to consumer slots in a round-robin fashion:
+    return numa_ ? (index % workers_.size()):index;
+}
+
+size_t QueueDispatcher::local_queue()
+{
+    // Consumer deque when dispatched from our own consumer (nested dispatch), producer node or round-robin otherwise
+    // (per producer thread, starting at different slots, so producers do not share a counter):
+    if (current_worker.dispatcher == this) return worker_queue(current_worker.index);
+    thread_local size_t next = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+    if (!numa_)
+    {
+        // Only slots of running consumers (retired ones may be anywhere in the pool):
+        for (size_t i = 0; i < workers_.size(); i++)
+        {
+            size_t index = next++ % workers_.size();
+            if (live_[index].load(std::memory_order_relaxed)) return index;
         }
+        return next % workers_.size();
     }
+
+#ifdef SYSTEM_LINUX
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && cpu < cpu_node_.size() && cpu_node_[cpu] >= 0) return cpu_node_[cpu];
+#endif
+    return next++ % workers_.size();
+}
+
+bool QueueDispatcher::busy_consumers() const
+{
+    // No idle consumers, and no margin to create new consumer threads:
+    size_t threads = num_threads_.load();
+    return (busy_threads_.load() >= threads && threads == max_threads_);
 }
 
-void QueueDispatcher::create_thread(void)
+ConsumerMetrics *QueueDispatcher::consumer_metrics() const
 {
-    threads_.push_back(std::thread(&QueueDispatcher::dispatch_thread_handler, this));
+    if (!metrics_ || current_worker.dispatcher != this) return nullptr;
+    return &metrics_[current_worker.index];
 }
 
-void QueueDispatcher::dispatch_thread_handler(void)
+void QueueDispatcher::account(ConsumerMetrics *metrics, const Task &task, std::chrono::steady_clock::time_point begin, std::uint64_t lapse, size_t inFlight)
 {
+    std::uint64_t wait = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - task.admitted).count();
+
+    if (metrics)
+    {
+        metrics->queueWait.record(wait);
+        metrics->service.record(lapse);
+        ConsumerMetrics::add(metrics->busy, lapse);
+    }
+
+    if (limiter_) limiter_->sample(wait, lapse, inFlight);
+}
+
+void QueueDispatcher::on_dequeue(std::vector<Task> &batch)
+{
+    if (recorder_)
+    {
+        std::chrono::steady_clock::time_point now;
+        for (auto &task: batch)
+        {
+            if (!task.traced) continue;
+            if (now == std::chrono::steady_clock::time_point()) now = std::chrono::steady_clock::now();
+            task.dequeued = now;
+        }
+    }
+
+    ConsumerMetrics *metrics = consumer_metrics();
+    if (!metrics) return;
+
+    size_t depth = getSize() + batch.size();
+    if (depth > metrics->peakDepth.load(std::memory_order_relaxed)) metrics->peakDepth.store(depth, std::memory_order_relaxed);
+}
+
+void QueueDispatcher::trace(const Task &task, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+{
+    // Consumer rings have a single writer (their consumer):
+    if (current_worker.dispatcher != this) return;
+
+    auto dequeued = (task.dequeued == std::chrono::steady_clock::time_point()) ? begin:task.dequeued;
+    recorder_->record(current_worker.index, task.admitted, dequeued, begin, end, getSize(), task.priority);
+}
+
+bool QueueDispatcher::discard_expired(Task &task)
+{
+    if (task.deadline == std::chrono::steady_clock::time_point::max() || std::chrono::steady_clock::now() <= task.deadline) return false;
+
+    expired_.fetch_add(1, std::memory_order_relaxed);
+    if (task.stream) task.stream->onExpired();
+    task.call.reset();
+    if (task.keyed) release_key(task.key);
+    return true;
+}
+
+void QueueDispatcher::process(Task &task)
+{
+    if (discard_expired(task)) return;
+
+    ConsumerMetrics *metrics = consumer_metrics();
+    bool timed = (metrics || limiter_ || task.traced);
+
+    if (!task.stream)
+    {
+        if (timed)
+        {
+            size_t inFlight = limiter_ ? (getSize() + busy_threads_.load()):0;
+            auto begin = std::chrono::steady_clock::now();
+            task.call();
+            auto end = std::chrono::steady_clock::now();
+            account(metrics, task, begin, std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count(), inFlight);
+            if (task.traced) trace(task, begin, end);
+        }
+        else task.call();
+        task.call.reset();
+        if (task.keyed) release_key(task.key);
+        return;
+    }
+
+    ProcessContext context;
+    context.busyConsumers = busy_consumers();
+    context.queueSize = getSize();
+    context.priority = task.priority;
+    if (limiter_)
+    {
+        context.inFlight = context.queueSize + busy_threads_.load();
+        context.limit = limiter_->limit();
+        context.shed = (context.inFlight > context.limit);
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    if (timed) context.queueWait = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - task.admitted).count();
+    task.stream->processWithContext(context);
+    auto end = std::chrono::steady_clock::now();
+
+    // Stream could store statistics and take it together with busyConsumers and queue size to implement
+    // congestion control algorithms
+    unsigned long long lapse = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    task.stream->processLapse(lapse);
+    if (timed) account(metrics, task, begin, lapse, context.inFlight);
+    if (task.traced) trace(task, begin, end);
+
+    if (task.keyed) release_key(task.key);
+}
+
+void QueueDispatcher::process(std::vector<Task> &batch, std::vector<std::shared_ptr<StreamIf>> &streams)
+{
+    // Batches are drained from a single priority class:
+    unsigned c = batch.front().priority;
+    if (weights_.size() > 1) class_busy_[c]++;
+
+    // Expired tasks are discarded before lending the batch to the hook:
+    batch.erase(std::remove_if(batch.begin(), batch.end(), [this](Task &task) { return discard_expired(task); }), batch.end());
+
+    // Callables have no batch hook:
+    bool streamsOnly = std::all_of(batch.begin(), batch.end(), [](const Task &task) { return bool(task.stream); });
+
+    if (batch.size() <= 1 || !streamsOnly)
+    {
+        for (auto &task: batch) process(task);
+    }
+    else
+    {
+        // Streams are lent to the hook (moved, not copied, to avoid reference counting):
+        for (auto &task: batch) streams.push_back(std::move(task.stream));
+
+        bool busyConsumers = busy_consumers();
+        size_t inFlight = limiter_ ? (getSize() + busy_threads_.load()):0;
+
+        auto begin = std::chrono::steady_clock::now();
+        bool processed = streams.front()->processBatch(streams, busyConsumers, getSize());
+        auto end = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i < batch.size(); i++) batch[i].stream = std::move(streams[i]);
+        streams.clear();
+
+        if (processed)
+        {
+            unsigned long long lapse = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / batch.size();
+            ConsumerMetrics *metrics = consumer_metrics();
+            for (auto &task: batch)
+            {
+                task.stream->processLapse(lapse);
+                if (metrics || limiter_) account(metrics, task, begin, lapse, inFlight);
+                if (task.traced) trace(task, begin, end);
+                if (task.keyed) release_key(task.key);
+            }
+        }
+        else
+        {
+            for (auto &task: batch) process(task);
+        }
+    }
+
+    if (weights_.size() > 1) class_busy_[c]--;
+}
+
+template <typename Ready>
+int QueueDispatcher::pick_class(ClassCursor &cursor, Ready ready) const
+{
+    size_t classes = weights_.size();
+    if (classes == 1) return ready(0) ? 0:-1;
+
+    if (strict_priority_)
+    {
+        for (size_t c = 0; c < classes; c++) if (ready(c)) return c;
+        return -1;
+    }
+
+    // Weighted round-robin: stay on current class while it has credit and pending work
+    for (size_t i = 0; i <= classes; i++)
+    {
+        if (cursor.credit > 0 && ready(cursor.current))
+        {
+            cursor.credit--;
+            return cursor.current;
+        }
+        cursor.current = (cursor.current + 1) % classes;
+        cursor.credit = weights_[cursor.current];
+    }
+
+    return -1;
+}
+
+void QueueDispatcher::dispatch_thread_handler(size_t index)
+{
+    current_worker = CurrentWorker{this, index};
+    ClassCursor cursor;
+    std::vector<Task> batch;
+    std::vector<std::shared_ptr<StreamIf>> streams;
+    batch.reserve(batch_size_);
+    streams.reserve(batch_size_);
     std::unique_lock<std::mutex> lock(lock_);
 
     do
     {
-        //Wait until we have data or a quit signal
-        cv_.wait(lock, [this]
+        // Poll for a while before parking (without the lock, so producers are not delayed):
+        if (!has_pending() && !quit_ && spin_iterations_ > 0)
         {
-            return (q_.size() || quit_);
-        });
+            lock.unlock();
+            spin();
+            lock.lock();
+        }
 
-        //after wait, we own the lock
-        if (!quit_ && q_.size())
+        // Wait until we have data or a quit signal. Registered as sleeper, so producers (which
+        // check it under the same lock) only notify when some consumer is parked:
+        bool idle = false;
+        sleepers_.park();
+        while (!has_pending() && !quit_)
         {
-            auto st = std::move(q_.front());
-            q_.pop();
+            if (idle_timeout_.count() == 0)
+            {
+                cv_.wait(lock);
+            }
+            else if (cv_.wait_for(lock, idle_timeout_) == std::cv_status::timeout && !has_pending() && !quit_)
+            {
+                idle = true;
+                break;
+            }
+        }
+        sleepers_.unpark();
 
+        if (idle)
+        {
+            if (retire(index)) break;
+            continue;
+        }
+
+        //after wait, we own the lock
+        if (!quit_ && pop_batch(cursor, batch) > 0)
+        {
             busy_threads_++;
 
             //unlock now that we're done messing with the queue
             lock.unlock();
+            release_room(batch.size());
 
-            // No idle consumers, and no margin to create new consumer threads:
-            bool busyConsumers = (busy_threads_.load() == threads_.size() && threads_.size() == max_threads_);
-
-            auto begin = std::chrono::steady_clock::now();
-            st->process(busyConsumers, q_.size());
-            auto end = std::chrono::steady_clock::now();
+            // Backlog left behind could still need more consumers:
+            grow(0);
 
-            // Stream could store statistics and take it together with busyConsumers and queue size to implement
-            // congestion control algorithms
-            st->processLapse(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+            process(batch, streams);
+            batch.clear();
 
             lock.lock();
             busy_threads_--;
         }
     }
     while (!quit_);
+
+    current_worker = CurrentWorker{nullptr, 0};
+}
+
+size_t QueueDispatcher::pop_batch(ClassCursor &cursor, std::vector<Task> &batch)
+{
+    // Locked backend (lock held):
+    int c = pick_class(cursor, [this](size_t c) {
+        return !q_[c].empty();
+    });
+    if (c < 0) return 0;
+
+    Fifo<Task> &q = q_[c];
+    while (q.size() && batch.size() < batch_size_)
+    {
+        batch.push_back(std::move(q.front()));
+        q.pop();
+    }
+    class_pending_[c] -= batch.size();
+    pending_ -= batch.size();
+    on_dequeue(batch);
+    return batch.size();
+}
+
+void QueueDispatcher::run(size_t index)
+{
+    // Executor turn of a virtual queue: up to weight batches
+    current_worker = CurrentWorker{this, index};
+    Turn &turn = turns_[index];
+
+    for (unsigned i = 0; i < weight_; i++)
+    {
+        std::unique_lock<std::mutex> lock(lock_);
+        if (pop_batch(turn.cursor, turn.batch) == 0) break;
+        busy_threads_++;
+        lock.unlock();
+
+        release_room(turn.batch.size());
+        process(turn.batch, turn.streams);
+        turn.batch.clear();
+        busy_threads_--;
+    }
+
+    current_worker = CurrentWorker{nullptr, 0};
+}
+
+bool QueueDispatcher::steal(size_t index, ClassCursor &cursor, Task &task)
+{
+    size_t own = worker_queue(index);
+    for (size_t i = 1; i < workers_.size(); i++)
+    {
+        Worker &worker = *workers_[(own + i) % workers_.size()];
+        std::lock_guard<std::mutex> guard(worker.lock);
+        int c = pick_class(cursor, [&worker](size_t c) {
+            return !worker.tasks[c].empty();
+        });
+        if (c >= 0)
+        {
+            task = std::move(worker.tasks[c].front());
+            worker.tasks[c].pop();
+            worker.count(c, -1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t QueueDispatcher::try_pop(size_t index, ClassCursor &cursor, std::vector<Task> &batch)
+{
+    Task task;
+
+    if (!rings_.empty())
+    {
+        int c = pick_class(cursor, [this](size_t c) {
+            return !rings_[c]->empty();
+        });
+        if (c < 0) return 0;
+
+        while (batch.size() < batch_size_ && rings_[c]->tryPop(task)) batch.push_back(std::move(task));
+        return batch.size();
+    }
+
+    // Own deque first (drain up to batch size), then steal a single task from peers:
+    {
+        Worker &worker = *workers_[worker_queue(index)];
+        std::lock_guard<std::mutex> guard(worker.lock);
+        int c = pick_class(cursor, [&worker](size_t c) {
+            return !worker.tasks[c].empty();
+        });
+        if (c >= 0)
+        {
+            Fifo<Task> &tasks = worker.tasks[c];
+            while (!tasks.empty() && batch.size() < batch_size_)
+            {
+                batch.push_back(std::move(tasks.front()));
+                tasks.pop();
+            }
+            worker.count(c, -int(batch.size()));
+        }
+    }
+
+    if (batch.empty() && steal(index, cursor, task)) batch.push_back(std::move(task));
+    return batch.size();
+}
+
+bool QueueDispatcher::has_pending() const
+{
+    if (!workers_.empty())
+    {
+        for (auto &worker: workers_)
+        {
+            if (worker->total.load(std::memory_order_relaxed) > 0) return true;
+        }
+        return false;
+    }
+
+    if (rings_.empty()) return (pending_.load() > 0);
+
+    for (size_t c = 0; c < weights_.size(); c++)
+    {
+        if (!rings_[c]->empty()) return true;
+    }
+    return false;
 }
 
-void QueueDispatcher::dispatch(std::shared_ptr<StreamIf> st)
+bool QueueDispatcher::spin() const
 {
-    if (busy_threads_.load() == threads_.size() && threads_.size() < max_threads_)
+    return spinUntil(spin_iterations_, [this] { return has_pending(); });
+}
+
+void QueueDispatcher::wake_consumers(size_t count)
+{
+    // Only wake up consumers when some of them is parked:
+    sleepers_.wake(lock_, cv_, count);
+}
+
+void QueueDispatcher::notify_consumers(size_t count, size_t sleepers)
+{
+    // Virtual queue: the executor schedules turns for the pending work (unless detached)
+    if (member_)
     {
-        create_thread();
+        executor_->notify(member_);
+        return;
+    }
+
+    // Only parked consumers need a wakeup:
+    count = std::min(count, sleepers);
+    while (count--) cv_.notify_one();
+}
+
+void QueueDispatcher::worker_thread_handler(size_t index)
+{
+    current_worker = CurrentWorker{this, index};
+    ClassCursor cursor;
+    std::vector<Task> batch;
+    std::vector<std::shared_ptr<StreamIf>> streams;
+    batch.reserve(batch_size_);
+    streams.reserve(batch_size_);
+
+    while (!quit_)
+    {
+        if (try_pop(index, cursor, batch) > 0)
+        {
+            on_dequeue(batch);
+            release_room(batch.size());
+            busy_threads_++;
+            grow(0);
+            process(batch, streams);
+            batch.clear();
+            busy_threads_--;
+            continue;
+        }
+
+        // Element claimed by a producer but still not published:
+        if (has_pending())
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Poll for a while before parking:
+        if (spin()) continue;
+
+        // Park until producers publish data or a quit signal is received.
+        // Registering as sleeper before checking pending work (both sides fenced)
+        // guarantees that a producer either sees us parked or we see its data:
+        std::unique_lock<std::mutex> lock(lock_);
+        bool retired = false;
+        sleepers_.park();
+        while (!quit_ && !has_pending())
+        {
+            if (idle_timeout_.count() == 0)
+            {
+                cv_.wait(lock);
+            }
+            else if (cv_.wait_for(lock, idle_timeout_) == std::cv_status::timeout && !has_pending() && retire(index))
+            {
+                retired = true;
+                break;
+            }
+        }
+        sleepers_.unpark();
+
+        if (quit_ || retired) break;
+    }
+
+    current_worker = CurrentWorker{nullptr, 0};
+}
+
+void QueueDispatcher::grow(size_t incoming)
+{
+    // Cheap checks first (no lock): margin to grow, utilization and queue depth
+    if (quit_) return;
+    size_t threads = num_threads_.load();
+    if (threads >= max_threads_) return;
+    if (busy_threads_.load() < grow_utilization_ * threads) return;
+    if (getSize() + incoming < grow_queue_depth_) return;
+
+    std::lock_guard<std::mutex> guard(pool_lock_);
+    if (quit_) return; // pool already taken by destructor
+    threads = num_threads_.load();
+    if (threads >= max_threads_ || busy_threads_.load() < grow_utilization_ * threads) return; // concurrent growth
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_resize_ < resize_hysteresis_) return;
+
+    for (size_t i = 0; i < max_threads_; i++)
+    {
+        if (!alive_[i])
+        {
+            start_thread(i);
+            last_resize_ = now;
+            if (recorder_) recorder_->record(FlightRecorder::Kind::Grow, threads + 1);
+            LOGDEBUG(ert::tracing::Logger::debug(ert::tracing::Logger::asString("Queue '%s' grows to %zu threads", name_.c_str(), threads + 1), ERT_FILE_LOCATION));
+            return;
+        }
+    }
+}
+
+bool QueueDispatcher::retire(size_t index)
+{
+    std::lock_guard<std::mutex> guard(pool_lock_);
+    size_t threads = num_threads_.load();
+    if (threads <= initial_threads_) return false;
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_resize_ < resize_hysteresis_) return false;
+
+    alive_[index] = false;
+    if (live_) live_[index] = false;
+    num_threads_--;
+    last_resize_ = now;
+    if (recorder_) recorder_->record(FlightRecorder::Kind::Shrink, threads - 1);
+    LOGDEBUG(ert::tracing::Logger::debug(ert::tracing::Logger::asString("Queue '%s' shrinks to %zu threads", name_.c_str(), threads - 1), ERT_FILE_LOCATION));
+    return true;
+}
+
+void QueueDispatcher::push_ring(Task &&task)
+{
+    unsigned c = task.priority;
+
+    // Bounded ring: wait for room when consumers are behind. Our own consumers
+    // (nested dispatch, key release, timers fed from a consumer) help draining
+    // instead, as all of them could be waiting for room otherwise:
+    while (!rings_[c]->tryPush(std::move(task)))
+    {
+        Task other;
+        if (current_worker.dispatcher == this && rings_[c]->tryPop(other))
+        {
+            release_room();
+            process(other);
+        }
+        else std::this_thread::yield();
+    }
+}
+
+void QueueDispatcher::enqueue(Task &&task)
+{
+    unsigned c = task.priority;
+
+    if (!rings_.empty())
+    {
+        push_ring(std::move(task));
+        wake_consumers();
+        return;
+    }
+
+    if (!workers_.empty())
+    {
+        Worker &worker = *workers_[local_queue()];
+        {
+            std::lock_guard<std::mutex> guard(worker.lock);
+            worker.tasks[c].push(std::move(task));
+            worker.count(c, 1);
+        }
+        wake_consumers();
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(lock_);
+    q_[c].push(std::move(task));
+    class_pending_[c]++;
+    pending_++;
+    size_t sleepers = sleepers_.count();
+
+    // Manual unlocking is done before notifying, to avoid waking up
+    // the waiting thread only to block again (see notify_one for details)
+    lock.unlock();
+    notify_consumers(1, sleepers);
+}
+
+void QueueDispatcher::enqueue(std::vector<Task> &tasks)
+{
+    // Due timers: admission first (rejected tasks are dropped), as it may need to evict:
+    size_t count = 0;
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+        if (!admit(tasks[i], true)) continue;
+        if (count != i) tasks[count] = std::move(tasks[i]);
+        count++;
+    }
+    tasks.resize(count);
+    push_batch(tasks, true);
+}
+
+void QueueDispatcher::push_batch(std::vector<Task> &tasks, bool timer)
+{
+    size_t count = tasks.size();
+    if (count == 0) return;
+
+    // Consumers drain up to batch size per wakeup:
+    size_t wakeups = (count + batch_size_ - 1) / batch_size_;
+
+    grow(count);
+
+    if (!rings_.empty())
+    {
+        for (auto &task: tasks)
+        {
+            // Timer thread cannot wait for room in the ring (bounded even for unbounded queues), as it
+            // feeds other queues too: due task is rejected instead
+            if (!timer) push_ring(std::move(task));
+            else if (!rings_[task.priority]->tryPush(std::move(task))) reject_due(task);
+        }
+        wake_consumers(wakeups);
+        return;
+    }
+
+    if (!workers_.empty())
+    {
+        // Whole batch to a single deque (one lock acquisition); woken peers will steal from it:
+        Worker &worker = *workers_[local_queue()];
+        {
+            std::lock_guard<std::mutex> guard(worker.lock);
+            for (auto &task: tasks)
+            {
+                worker.count(task.priority, 1);
+                worker.tasks[task.priority].push(std::move(task));
+            }
+        }
+        wake_consumers(wakeups);
+        return;
     }
 
     std::unique_lock<std::mutex> lock(lock_);
-    //    q_.push(std::move(st));
-    //
-    //    // Manual unlocking is done before notifying, to avoid waking up
-    //    // the waiting thread only to block again (see notify_one for details)
-    //    lock.unlock();
-    //    cv_.notify_one();
-
-    q_.push(st);
+    for (auto &task: tasks)
+    {
+        unsigned c = task.priority;
+        class_pending_[c]++;
+        q_[c].push(std::move(task));
+    }
+    pending_ += count;
+    size_t sleepers = sleepers_.count();
     lock.unlock();
-    cv_.notify_one();
+
+    notify_consumers(wakeups, sleepers);
+}
+
+void QueueDispatcher::reject_due(Task &task)
+{
+    // Admitted, but with no room left in the ring:
+    release_room();
+    if (metrics_)
+    {
+        ProducerCounters &counters = producer_counters();
+        counters.enqueued.fetch_sub(1, std::memory_order_relaxed);
+        counters.rejected.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (task.stream) task.stream->onRejected();
+}
+
+QueueDispatcher::TimerId QueueDispatcher::add_timer(Task &&task, std::chrono::steady_clock::time_point at, std::chrono::nanoseconds period, std::shared_ptr<Callable> periodic)
+{
+    return timers_->add(this, std::move(task), at, period, std::move(periodic));
+}
+
+bool QueueDispatcher::cancel(TimerId id)
+{
+    return timers_->cancel(this, id);
+}
+
+size_t QueueDispatcher::getTimers() const
+{
+    return timers_->size(this);
+}
+
+bool QueueDispatcher::reserve_room()
+{
+    size_t admitted = admitted_.load();
+    while (admitted < capacity_)
+    {
+        if (admitted_.compare_exchange_weak(admitted, admitted + 1)) return true;
+    }
+    return false;
+}
+
+void QueueDispatcher::release_room(size_t count)
+{
+    if (capacity_ == 0) return;
+    admitted_ -= count;
+
+    // Only wake up producers when some of them is waiting for room (both sides fenced):
+    if (overload_policy_ != OverloadPolicy::Block) return;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (blocked_.load() == 0) return;
+
+    {
+        std::lock_guard<std::mutex> guard(room_lock_);
+    }
+    if (count > 1) room_cv_.notify_all();
+    else room_cv_.notify_one();
+}
+
+bool QueueDispatcher::evict_oldest(Task &task)
+{
+    // Lowest priority classes are evicted first:
+    for (size_t c = weights_.size(); c-- > 0;)
+    {
+        if (!rings_.empty())
+        {
+            if (rings_[c]->tryPop(task)) return true;
+        }
+        else if (!workers_.empty())
+        {
+            for (auto &worker: workers_)
+            {
+                if (worker->pending[c].load(std::memory_order_relaxed) == 0) continue;
+                std::lock_guard<std::mutex> guard(worker->lock);
+                if (worker->tasks[c].empty()) continue;
+                task = std::move(worker->tasks[c].front());
+                worker->tasks[c].pop();
+                worker->count(c, -1);
+                return true;
+            }
+        }
+        else
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (q_[c].empty()) continue;
+            task = std::move(q_[c].front());
+            q_[c].pop();
+            class_pending_[c]--;
+            pending_--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool QueueDispatcher::drain_for_room()
+{
+    // Pending tasks run here until there is room. New task is the discarded one when nothing is left
+    // (everything admitted is in consumers hands or waiting in key lanes):
+    Task task;
+    while (!reserve_room())
+    {
+        if (!evict_oldest(task)) return false;
+        release_room();
+        process(task);
+        task = Task();
+    }
+    return true;
+}
+
+QueueDispatcher::ProducerCounters &QueueDispatcher::producer_counters()
+{
+    // Threads are spread over the shards in order of first use:
+    static std::atomic<size_t> threads{0};
+    thread_local size_t shard = threads++ % ProducerShards;
+    return producer_counters_[shard];
+}
+
+bool QueueDispatcher::admit(Task &task, bool timer)
+{
+    bool admitted = true;
+    if (capacity_ > 0 && !reserve_room())
+    {
+        // Coroutine resumptions take room anyway, as they cannot be discarded:
+        if (task.resumption) admitted_++;
+        else admitted = overload(task, timer);
+    }
+
+    if (metrics_)
+    {
+        ProducerCounters &counters = producer_counters();
+        (admitted ? counters.enqueued:counters.rejected).fetch_add(1, std::memory_order_relaxed);
+    }
+    if (recorder_) task.traced = recorder_->sample();
+    if (metrics_ || limiter_ || task.traced) task.admitted = std::chrono::steady_clock::now();
+
+    return admitted;
+}
+
+bool QueueDispatcher::overload(Task &task, bool timer)
+{
+    switch (overload_policy_)
+    {
+    case OverloadPolicy::Block:
+    {
+        // Timer thread cannot wait for room (later timers would be late), and nobody else could be
+        // told about the rejection:
+        if (timer)
+        {
+            if (task.stream) task.stream->onRejected();
+            return false;
+        }
+
+        // Our own consumers (nested dispatch) cannot wait either, as all of them could be waiting
+        // and nobody else releases room: they help draining the queue instead
+        if (current_worker.dispatcher == this) return drain_for_room();
+
+        auto ready = [this] { return reserve_room(); };
+        std::unique_lock<std::mutex> lock(room_lock_);
+        blocked_++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool admitted = true;
+        if (block_timeout_.count() == 0) room_cv_.wait(lock, ready);
+        else admitted = room_cv_.wait_for(lock, block_timeout_, ready);
+        blocked_--;
+        return admitted;
+    }
+    case OverloadPolicy::DropOldest:
+    {
+        // New task inherits the room of the evicted one. Nothing may be evictable while consumers
+        // still release the room of dequeued tasks, so admission is retried meanwhile:
+        Task oldest;
+        for (int attempt = 0; attempt < 64; attempt++)
+        {
+            if (evict_oldest(oldest))
+            {
+                // Coroutine resumptions are never discarded: the evicted one runs on this thread
+                if (oldest.resumption)
+                {
+                    oldest.call();
+                    return true;
+                }
+                if (metrics_) producer_counters().rejected.fetch_add(1, std::memory_order_relaxed);
+                if (oldest.stream) oldest.stream->onRejected();
+                if (oldest.keyed) release_key(oldest.key);
+                return true;
+            }
+            if (reserve_room()) return true;
+            std::this_thread::yield();
+        }
+
+        // Everything admitted is waiting in key lanes: new task is the discarded one
+        if (task.stream) task.stream->onRejected();
+        return false;
+    }
+    case OverloadPolicy::Callback:
+        if (task.stream) task.stream->onRejected();
+        return false;
+    default:
+        // Rejections are returned to the producer, but due timers have nobody to return them to:
+        if (timer && task.stream) task.stream->onRejected();
+        return false;
+    }
+}
+
+bool QueueDispatcher::submit(Task &&task)
+{
+    if (!task.keyed)
+    {
+        grow();
+
+        if (!admit(task)) return false;
+        enqueue(std::move(task));
+        return true;
+    }
+
+    if (!admit(task)) return false;
+
+    KeyShard &shard = key_shard(task.key);
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        Fifo<Task> *lane = shard.lanes.find(task.key);
+        if (lane)
+        {
+            // Some task with this key is already in flight: wait behind it
+            lane->push(std::move(task));
+            return true;
+        }
+        shard.lanes.open(task.key);
+    }
+
+    grow();
+    enqueue(std::move(task));
+    return true;
+}
+
+bool QueueDispatcher::tryDispatch(std::shared_ptr<StreamIf> st, int priority)
+{
+    return submit(Task{std::move(st), 0, false, priority_class(priority)});
+}
+
+bool QueueDispatcher::tryDispatch(std::uint64_t key, std::shared_ptr<StreamIf> st, int priority)
+{
+    return submit(Task{std::move(st), key, true, priority_class(priority)});
+}
+
+bool QueueDispatcher::tryDispatch(std::shared_ptr<StreamIf> st, Deadline deadline, int priority)
+{
+    return submit(Task{std::move(st), 0, false, priority_class(priority), {}, {}, deadline.at()});
+}
+
+bool QueueDispatcher::tryDispatch(std::uint64_t key, std::shared_ptr<StreamIf> st, Deadline deadline, int priority)
+{
+    return submit(Task{std::move(st), key, true, priority_class(priority), {}, {}, deadline.at()});
+}
+
+QueueDispatcher::KeyShard &QueueDispatcher::key_shard(std::uint64_t key)
+{
+    // Fibonacci hashing spreads sequential keys over the shards:
+    return key_shards_[(key * 0x9E3779B97F4A7C15ull) >> 58];
+}
+
+void QueueDispatcher::release_key(std::uint64_t key)
+{
+    Task next;
+    KeyShard &shard = key_shard(key);
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        Fifo<Task> *lane = shard.lanes.find(key);
+        if (!lane) return;
+
+        if (lane->empty())
+        {
+            shard.lanes.close(key);
+            return;
+        }
+        next = std::move(lane->front());
+        lane->pop();
+    }
+
+    // Next task for the key goes to the tail, so other keys are not starved:
+    enqueue(std::move(next));
+}
+
+size_t QueueDispatcher::dispatchBatch(std::vector<std::shared_ptr<StreamIf>> &streams, int priority)
+{
+    unsigned c = priority_class(priority);
+
+    // Tasks are built in a buffer reused by the producer thread (a new one only when this is a nested
+    // dispatch from a task run while the buffer is in use):
+    thread_local std::vector<Task> scratch;
+    std::vector<Task> nested;
+    std::vector<Task> &tasks = scratch.empty() ? scratch:nested;
+
+    // Admission first, as it may need to wait or evict. Admitted tasks keep the admission time and
+    // flight recorder sampling taken there:
+    size_t count = 0;
+    for (auto &st: streams)
+    {
+        // Producers waiting for room need the tasks admitted so far in the queue, as only their
+        // consumers could release it:
+        if (overload_policy_ == OverloadPolicy::Block && capacity_ > 0 && !tasks.empty() && admitted_.load() >= capacity_)
+        {
+            count += tasks.size();
+            push_batch(tasks);
+            tasks.clear();
+        }
+
+        Task task{std::move(st), 0, false, c};
+        if (admit(task)) tasks.push_back(std::move(task));
+    }
+    streams.clear();
+
+    count += tasks.size();
+    push_batch(tasks);
+    tasks.clear();
+
+    return count;
+}
+
+MetricsSnapshot QueueDispatcher::getMetrics()
+{
+    MetricsSnapshot snapshot;
+    snapshot.depth = getSize();
+    snapshot.threads = num_threads_.load();
+    snapshot.busyThreads = busy_threads_.load();
+    snapshot.limit = getLimit();
+    snapshot.expired = expired_.load(std::memory_order_relaxed);
+    if (!metrics_) return snapshot;
+
+    for (size_t i = 0; i < ProducerShards; i++)
+    {
+        snapshot.enqueued += producer_counters_[i].enqueued.load(std::memory_order_relaxed);
+        snapshot.rejected += producer_counters_[i].rejected.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t busy = 0;
+    for (size_t i = 0; i < consumer_slots_; i++)
+    {
+        const ConsumerMetrics &metrics = metrics_[i];
+        metrics.queueWait.collect(snapshot.queueWait);
+        metrics.service.collect(snapshot.service);
+        busy += metrics.busy.load(std::memory_order_relaxed);
+        size_t peak = metrics.peakDepth.load(std::memory_order_relaxed);
+        if (peak > snapshot.peakDepth) snapshot.peakDepth = peak;
+    }
+    snapshot.processed = snapshot.service.count;
+    snapshot.busySeconds = busy / 1e9;
+
+    // Utilization since previous snapshot (current pool size is assumed for the whole window):
+    std::lock_guard<std::mutex> guard(metrics_lock_);
+    auto now = std::chrono::steady_clock::now();
+    double window = std::chrono::duration_cast<std::chrono::nanoseconds>(now - metrics_since_).count() * (double)snapshot.threads;
+    if (window > 0) snapshot.utilization = std::min(1.0, (busy - metrics_busy_) / window);
+    metrics_since_ = now;
+    metrics_busy_ = busy;
+
+    return snapshot;
 }
 
 
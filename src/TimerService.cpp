@@ -0,0 +1,197 @@
+/*
+ _____________________________________________________________________________________________________
+|             _                                         _ _                 _       _                 |
+|            | |                                       | (_)               | |     | |                |
+|    ___ _ __| |_   __   __ _ _   _  ___ _   _  ___  __| |_ ___ _ __   __ _| |_ ___| |__   ___ _ __   |
+|   / _ \ '__| __| |__| / _` | | | |/ _ \ | | |/ _ \/ _` | / __| '_ \ / _` | __/ __| '_ \ / _ \ '__|  |
+|  |  __/ |  | |_      | (_| | |_| |  __/ |_| |  __/ (_| | \__ \ |_) | (_| | || (__| | | |  __/ |     |
+|   \___|_|   \__|      \__, |\__,_|\___|\__,_|\___|\__,_|_|___/ .__/ \__,_|\__\___|_| |_|\___|_|     |
+|                          | |                                 | |                                    |
+|                          |_|                                 |_|                                    |
+|_____________________________________________________________________________________________________|
+
+ QUEUE DISPATCHER LIBRARY C++
+ Version 0.0.z
+ https://github.com/testillano/queuedispatcher
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+SPDX-License-Identifier: MIT
+Copyright (c) 2021 Eduardo Ramos
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+
+#include <ert/tracing/Logger.hpp>
+
+#include <ert/queuedispatcher/TimerService.hpp>
+
+namespace ert
+{
+namespace queuedispatcher
+{
+
+TimerService::TimerService(std::string name, std::chrono::steady_clock::duration resolution) :
+    name_{std::move(name)}, resolution_(std::max(std::chrono::steady_clock::duration(std::chrono::microseconds(1)), resolution)),
+    origin_(std::chrono::steady_clock::now())
+{
+}
+
+TimerService::~TimerService()
+{
+    // Timers are discarded
+    std::unique_lock<std::mutex> lock(lock_);
+    quit_ = true;
+    lock.unlock();
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+std::uint64_t TimerService::ticks(std::chrono::steady_clock::duration duration) const
+{
+    // Ticks are rounded up, so timers never expire early:
+    if (duration.count() <= 0) return 0;
+    return (duration.count() + resolution_.count() - 1) / resolution_.count();
+}
+
+QueueDispatcher::TimerId TimerService::add(QueueDispatcher *queue, QueueDispatcher::Task &&task, std::chrono::steady_clock::time_point at,
+        std::chrono::nanoseconds period, std::shared_ptr<Callable> periodic)
+{
+    Timer timer{queue, std::move(task), 0, std::move(periodic)};
+    if (period.count() > 0) timer.period = std::max(std::uint64_t(1), ticks(period));
+
+    std::lock_guard<std::mutex> guard(lock_);
+    bool idle = wheel_.empty();
+    if (idle) wheel_.advance((std::chrono::steady_clock::now() - origin_) / resolution_, [](Timer&, std::uint64_t) { return std::uint64_t(0); });
+    std::uint64_t due = std::max(ticks(at - origin_), wheel_.tick() + 1);
+    QueueDispatcher::TimerId id = wheel_.add(due, std::move(timer));
+    queue->pending_timers_++;
+
+    // Thread sleeps until the next timer: wake it up when this one is earlier
+    if (!thread_.joinable())
+    {
+        thread_ = std::thread(&TimerService::thread_handler, this);
+        LOGDEBUG(ert::tracing::Logger::debug(ert::tracing::Logger::asString("Timer thread of '%s' started", name_.c_str()), ERT_FILE_LOCATION));
+    }
+    else if (idle || due < wakeup_) cv_.notify_one();
+
+    return id;
+}
+
+bool TimerService::cancel(QueueDispatcher *queue, QueueDispatcher::TimerId id)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    Timer *timer = wheel_.get(id);
+    if (!timer || timer->queue != queue) return false;
+
+    wheel_.cancel(id);
+    queue->pending_timers_--;
+    return true;
+}
+
+size_t TimerService::size(const QueueDispatcher *queue) const
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    return queue->pending_timers_;
+}
+
+void TimerService::detach(QueueDispatcher *queue)
+{
+    std::unique_lock<std::mutex> lock(lock_);
+    if (queue->pending_timers_ > 0) wheel_.cancelIf([queue](const Timer &timer) { return timer.queue == queue; });
+    queue->pending_timers_ = 0;
+
+    // Due tasks already taken from the wheel could be on their way to the queue:
+    fed_cv_.wait(lock, [this] { return !feeding_; });
+}
+
+void TimerService::thread_handler()
+{
+    // Due tasks are grouped per queue as they expire (batches are reused, so a warmed-up
+    // timer thread does not allocate):
+    std::vector<std::pair<QueueDispatcher*, std::vector<QueueDispatcher::Task>>> batches;
+    size_t used = 0;
+    auto collect = [&batches, &used](QueueDispatcher *queue, QueueDispatcher::Task &&task) {
+        if (queue->due_batch_ == 0)
+        {
+            if (used == batches.size()) batches.emplace_back();
+            batches[used].first = queue;
+            queue->due_batch_ = ++used;
+        }
+        batches[queue->due_batch_ - 1].second.push_back(std::move(task));
+    };
+
+    std::unique_lock<std::mutex> lock(lock_);
+
+    while (!quit_)
+    {
+        if (wheel_.empty())
+        {
+            cv_.wait(lock);
+            continue;
+        }
+
+        // Sleep until next occupied slot or cascade, then expire every tick elapsed (timer thread
+        // could be late). Earlier timers added meanwhile wake it up:
+        wakeup_ = wheel_.next();
+        cv_.wait_until(lock, origin_ + wakeup_ * resolution_);
+        wakeup_ = 0;
+        if (quit_) break;
+
+        wheel_.advance((std::chrono::steady_clock::now() - origin_) / resolution_, [&collect](Timer &timer, std::uint64_t tick) {
+            if (timer.period == 0)
+            {
+                timer.queue->pending_timers_--;
+                collect(timer.queue, std::move(timer.task));
+                return std::uint64_t(0);
+            }
+
+            // Periodic timers dispatch a copy (the same stream, or a call to the shared callable):
+            QueueDispatcher::Task task{timer.task.stream, 0, false, timer.task.priority};
+            if (timer.periodic)
+            {
+                std::shared_ptr<Callable> periodic = timer.periodic;
+                task.call = Callable([periodic] { (*periodic)(); });
+            }
+            collect(timer.queue, std::move(task));
+            return tick + timer.period;
+        });
+
+        if (used == 0) continue;
+        for (size_t i = 0; i < used; i++) batches[i].first->due_batch_ = 0;
+
+        // Due tasks are fed into their queues without holding the wheel (in expiry order), and
+        // detaching queues wait for it:
+        feeding_ = true;
+        lock.unlock();
+        for (size_t i = 0; i < used; i++)
+        {
+            batches[i].first->enqueue(batches[i].second);
+            batches[i].second.clear();
+        }
+        used = 0;
+        lock.lock();
+        feeding_ = false;
+        fed_cv_.notify_all();
+    }
+}
+
+}
+}